@@ -0,0 +1,1057 @@
+// Aes.cpp
+// AES block cipher backends (T-table, bitsliced, AES-NI / ARMv8 Crypto
+// Extensions) and the CTR / GCM modes built on top of them.
+
+#include "Aes.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "CpuFeatures.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define AES_HW_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define AES_HW_ARM 1
+#endif
+
+namespace aes {
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Byte order helpers
+
+inline uint32_t load32be(const uint8_t *p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+inline void store32be(uint8_t *p, uint32_t v)
+{
+    p[0] = uint8_t(v >> 24);
+    p[1] = uint8_t(v >> 16);
+    p[2] = uint8_t(v >> 8);
+    p[3] = uint8_t(v);
+}
+
+inline uint64_t load64be(const uint8_t *p)
+{
+    return (uint64_t(load32be(p)) << 32) | load32be(p + 4);
+}
+
+inline void store64be(uint8_t *p, uint64_t v)
+{
+    store32be(p, uint32_t(v >> 32));
+    store32be(p + 4, uint32_t(v));
+}
+
+inline uint64_t load64le(const uint8_t *p)
+{
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i)
+    {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+inline void store64le(uint8_t *p, uint64_t v)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        p[i] = uint8_t(v >> (8 * i));
+    }
+}
+
+// Increments the last 32 bits of a counter block (GCM's inc32).
+inline void increment32(uint8_t counter[16])
+{
+    store32be(counter + 12, load32be(counter + 12) + 1);
+}
+
+// ---------------------------------------------------------------------------
+// T-table backend
+
+inline uint8_t xtime(uint8_t x)
+{
+    return uint8_t((x << 1) ^ ((x & 0x80) ? 0x1B : 0x00));
+}
+
+inline uint32_t rotr32(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+struct Tables
+{
+    uint8_t sbox[256];
+    uint32_t te[4][256];
+
+    Tables()
+    {
+        // Walk the multiplicative group with generator 3, tracking the
+        // inverse (generator 3^-1 = 0xF6) to build the S-box directly.
+        uint8_t p = 1;
+        uint8_t q = 1;
+        do
+        {
+            p = uint8_t(p ^ (p << 1) ^ ((p & 0x80) ? 0x1B : 0));
+            q ^= uint8_t(q << 1);
+            q ^= uint8_t(q << 2);
+            q ^= uint8_t(q << 4);
+            if (q & 0x80)
+            {
+                q ^= 0x09;
+            }
+            uint8_t x = uint8_t(q ^ (q << 1 | q >> 7) ^ (q << 2 | q >> 6) ^ (q << 3 | q >> 5) ^ (q << 4 | q >> 4));
+            sbox[p] = uint8_t(x ^ 0x63);
+        } while (p != 1);
+        sbox[0] = 0x63;
+
+        for (int i = 0; i < 256; ++i)
+        {
+            uint8_t s = sbox[i];
+            uint8_t s2 = xtime(s);
+            uint8_t s3 = uint8_t(s2 ^ s);
+            uint32_t word = (uint32_t(s2) << 24) | (uint32_t(s) << 16) | (uint32_t(s) << 8) | s3;
+            te[0][i] = word;
+            te[1][i] = rotr32(word, 8);
+            te[2][i] = rotr32(word, 16);
+            te[3][i] = rotr32(word, 24);
+        }
+    }
+};
+
+const Tables &tables()
+{
+    static const Tables instance;
+    return instance;
+}
+
+void encryptTable(const uint32_t *rk, int rounds, const uint8_t in[16], uint8_t out[16])
+{
+    const Tables &t = tables();
+    const uint32_t(*te)[256] = t.te;
+
+    uint32_t s0 = load32be(in) ^ rk[0];
+    uint32_t s1 = load32be(in + 4) ^ rk[1];
+    uint32_t s2 = load32be(in + 8) ^ rk[2];
+    uint32_t s3 = load32be(in + 12) ^ rk[3];
+
+    for (int r = 1; r < rounds; ++r)
+    {
+        const uint32_t *k = rk + 4 * r;
+        uint32_t t0 = te[0][s0 >> 24] ^ te[1][(s1 >> 16) & 0xFF] ^ te[2][(s2 >> 8) & 0xFF] ^ te[3][s3 & 0xFF] ^ k[0];
+        uint32_t t1 = te[0][s1 >> 24] ^ te[1][(s2 >> 16) & 0xFF] ^ te[2][(s3 >> 8) & 0xFF] ^ te[3][s0 & 0xFF] ^ k[1];
+        uint32_t t2 = te[0][s2 >> 24] ^ te[1][(s3 >> 16) & 0xFF] ^ te[2][(s0 >> 8) & 0xFF] ^ te[3][s1 & 0xFF] ^ k[2];
+        uint32_t t3 = te[0][s3 >> 24] ^ te[1][(s0 >> 16) & 0xFF] ^ te[2][(s1 >> 8) & 0xFF] ^ te[3][s2 & 0xFF] ^ k[3];
+        s0 = t0;
+        s1 = t1;
+        s2 = t2;
+        s3 = t3;
+    }
+
+    // Last round: SubBytes + ShiftRows only.
+    const uint8_t *sb = t.sbox;
+    const uint32_t *k = rk + 4 * rounds;
+    store32be(out, ((uint32_t(sb[s0 >> 24]) << 24) | (uint32_t(sb[(s1 >> 16) & 0xFF]) << 16) |
+                    (uint32_t(sb[(s2 >> 8) & 0xFF]) << 8) | sb[s3 & 0xFF]) ^ k[0]);
+    store32be(out + 4, ((uint32_t(sb[s1 >> 24]) << 24) | (uint32_t(sb[(s2 >> 16) & 0xFF]) << 16) |
+                        (uint32_t(sb[(s3 >> 8) & 0xFF]) << 8) | sb[s0 & 0xFF]) ^ k[1]);
+    store32be(out + 8, ((uint32_t(sb[s2 >> 24]) << 24) | (uint32_t(sb[(s3 >> 16) & 0xFF]) << 16) |
+                        (uint32_t(sb[(s0 >> 8) & 0xFF]) << 8) | sb[s1 & 0xFF]) ^ k[2]);
+    store32be(out + 12, ((uint32_t(sb[s3 >> 24]) << 24) | (uint32_t(sb[(s0 >> 16) & 0xFF]) << 16) |
+                         (uint32_t(sb[(s1 >> 8) & 0xFF]) << 8) | sb[s2 & 0xFF]) ^ k[3]);
+}
+
+void ctrTable(const uint32_t *rk, int rounds, uint8_t *out, const uint8_t *in,
+              std::size_t blocks, uint8_t counter[16])
+{
+    uint8_t keystream[16];
+    for (std::size_t b = 0; b < blocks; ++b)
+    {
+        encryptTable(rk, rounds, counter, keystream);
+        increment32(counter);
+        for (int i = 0; i < 16; ++i)
+        {
+            out[16 * b + i] = in[16 * b + i] ^ keystream[i];
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Bitsliced backend
+//
+// Four blocks (64 bytes) are held as eight 64-bit bit planes: bit p of
+// plane j is bit j of byte p, where p = 16 * block + 4 * column + row.
+// Every operation is a fixed sequence of logic ops, so timing does not
+// depend on key or data.
+
+// Transposes an 8x8 bit matrix stored one row per byte.
+inline uint64_t transpose8x8(uint64_t x)
+{
+    x = (x & 0xAA55AA55AA55AA55ULL) | ((x & 0x00AA00AA00AA00AAULL) << 7) | ((x >> 7) & 0x00AA00AA00AA00AAULL);
+    x = (x & 0xCCCC3333CCCC3333ULL) | ((x & 0x0000CCCC0000CCCCULL) << 14) | ((x >> 14) & 0x0000CCCC0000CCCCULL);
+    x = (x & 0xF0F0F0F00F0F0F0FULL) | ((x & 0x00000000F0F0F0F0ULL) << 28) | ((x >> 28) & 0x00000000F0F0F0F0ULL);
+    return x;
+}
+
+void pack(uint64_t q[8], const uint8_t in[64])
+{
+    for (int j = 0; j < 8; ++j)
+    {
+        q[j] = 0;
+    }
+    for (int c = 0; c < 8; ++c)
+    {
+        uint64_t x = transpose8x8(load64le(in + 8 * c));
+        for (int j = 0; j < 8; ++j)
+        {
+            q[j] |= ((x >> (8 * j)) & 0xFF) << (8 * c);
+        }
+    }
+}
+
+void unpack(uint8_t out[64], const uint64_t q[8])
+{
+    for (int c = 0; c < 8; ++c)
+    {
+        uint64_t x = 0;
+        for (int j = 0; j < 8; ++j)
+        {
+            x |= ((q[j] >> (8 * c)) & 0xFF) << (8 * j);
+        }
+        store64le(out + 8 * c, transpose8x8(x));
+    }
+}
+
+// Boyar-Peralta S-box circuit (113 gates) applied to all 64 bytes.
+void subBytesBitsliced(uint64_t q[8])
+{
+    uint64_t x0 = q[7], x1 = q[6], x2 = q[5], x3 = q[4];
+    uint64_t x4 = q[3], x5 = q[2], x6 = q[1], x7 = q[0];
+
+    // Top linear transformation.
+    uint64_t y14 = x3 ^ x5;
+    uint64_t y13 = x0 ^ x6;
+    uint64_t y9 = x0 ^ x3;
+    uint64_t y8 = x0 ^ x5;
+    uint64_t t0 = x1 ^ x2;
+    uint64_t y1 = t0 ^ x7;
+    uint64_t y4 = y1 ^ x3;
+    uint64_t y12 = y13 ^ y14;
+    uint64_t y2 = y1 ^ x0;
+    uint64_t y5 = y1 ^ x6;
+    uint64_t y3 = y5 ^ y8;
+    uint64_t t1 = x4 ^ y12;
+    uint64_t y15 = t1 ^ x5;
+    uint64_t y20 = t1 ^ x1;
+    uint64_t y6 = y15 ^ x7;
+    uint64_t y10 = y15 ^ t0;
+    uint64_t y11 = y20 ^ y9;
+    uint64_t y7 = x7 ^ y11;
+    uint64_t y17 = y10 ^ y11;
+    uint64_t y19 = y10 ^ y8;
+    uint64_t y16 = t0 ^ y11;
+    uint64_t y21 = y13 ^ y16;
+    uint64_t y18 = x0 ^ y16;
+
+    // Non-linear section.
+    uint64_t t2 = y12 & y15;
+    uint64_t t3 = y3 & y6;
+    uint64_t t4 = t3 ^ t2;
+    uint64_t t5 = y4 & x7;
+    uint64_t t6 = t5 ^ t2;
+    uint64_t t7 = y13 & y16;
+    uint64_t t8 = y5 & y1;
+    uint64_t t9 = t8 ^ t7;
+    uint64_t t10 = y2 & y7;
+    uint64_t t11 = t10 ^ t7;
+    uint64_t t12 = y9 & y11;
+    uint64_t t13 = y14 & y17;
+    uint64_t t14 = t13 ^ t12;
+    uint64_t t15 = y8 & y10;
+    uint64_t t16 = t15 ^ t12;
+    uint64_t t17 = t4 ^ t14;
+    uint64_t t18 = t6 ^ t16;
+    uint64_t t19 = t9 ^ t14;
+    uint64_t t20 = t11 ^ t16;
+    uint64_t t21 = t17 ^ y20;
+    uint64_t t22 = t18 ^ y19;
+    uint64_t t23 = t19 ^ y21;
+    uint64_t t24 = t20 ^ y18;
+
+    uint64_t t25 = t21 ^ t22;
+    uint64_t t26 = t21 & t23;
+    uint64_t t27 = t24 ^ t26;
+    uint64_t t28 = t25 & t27;
+    uint64_t t29 = t28 ^ t22;
+    uint64_t t30 = t23 ^ t24;
+    uint64_t t31 = t22 ^ t26;
+    uint64_t t32 = t31 & t30;
+    uint64_t t33 = t32 ^ t24;
+    uint64_t t34 = t23 ^ t33;
+    uint64_t t35 = t27 ^ t33;
+    uint64_t t36 = t24 & t35;
+    uint64_t t37 = t36 ^ t34;
+    uint64_t t38 = t27 ^ t36;
+    uint64_t t39 = t29 & t38;
+    uint64_t t40 = t25 ^ t39;
+
+    uint64_t t41 = t40 ^ t37;
+    uint64_t t42 = t29 ^ t33;
+    uint64_t t43 = t29 ^ t40;
+    uint64_t t44 = t33 ^ t37;
+    uint64_t t45 = t42 ^ t41;
+    uint64_t z0 = t44 & y15;
+    uint64_t z1 = t37 & y6;
+    uint64_t z2 = t33 & x7;
+    uint64_t z3 = t43 & y16;
+    uint64_t z4 = t40 & y1;
+    uint64_t z5 = t29 & y7;
+    uint64_t z6 = t42 & y11;
+    uint64_t z7 = t45 & y17;
+    uint64_t z8 = t41 & y10;
+    uint64_t z9 = t44 & y12;
+    uint64_t z10 = t37 & y3;
+    uint64_t z11 = t33 & y4;
+    uint64_t z12 = t43 & y13;
+    uint64_t z13 = t40 & y5;
+    uint64_t z14 = t29 & y2;
+    uint64_t z15 = t42 & y9;
+    uint64_t z16 = t45 & y14;
+    uint64_t z17 = t41 & y8;
+
+    // Bottom linear transformation.
+    uint64_t t46 = z15 ^ z16;
+    uint64_t t47 = z10 ^ z11;
+    uint64_t t48 = z5 ^ z13;
+    uint64_t t49 = z9 ^ z10;
+    uint64_t t50 = z2 ^ z12;
+    uint64_t t51 = z2 ^ z5;
+    uint64_t t52 = z7 ^ z8;
+    uint64_t t53 = z0 ^ z3;
+    uint64_t t54 = z6 ^ z7;
+    uint64_t t55 = z16 ^ z17;
+    uint64_t t56 = z12 ^ t48;
+    uint64_t t57 = t50 ^ t53;
+    uint64_t t58 = z4 ^ t46;
+    uint64_t t59 = z3 ^ t54;
+    uint64_t t60 = t46 ^ t57;
+    uint64_t t61 = z14 ^ t57;
+    uint64_t t62 = t52 ^ t58;
+    uint64_t t63 = t49 ^ t58;
+    uint64_t t64 = z4 ^ t59;
+    uint64_t t65 = t61 ^ t62;
+    uint64_t t66 = z1 ^ t63;
+    uint64_t s0 = t59 ^ t63;
+    uint64_t s6 = t56 ^ ~t62;
+    uint64_t s7 = t48 ^ ~t60;
+    uint64_t t67 = t64 ^ t65;
+    uint64_t s3 = t53 ^ t66;
+    uint64_t s4 = t51 ^ t66;
+    uint64_t s5 = t47 ^ t65;
+    uint64_t s1 = t64 ^ ~s3;
+    uint64_t s2 = t55 ^ ~t67;
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+
+// Rotates each 16-bit lane (one block's bits of a plane) right by k.
+inline uint64_t rotateLanes16(uint64_t x, int k)
+{
+    const uint64_t low = (0xFFFFULL >> k) * 0x0001000100010001ULL;
+    return ((x >> k) & low) | ((x << (16 - k)) & ~low);
+}
+
+void shiftRowsBitsliced(uint64_t q[8])
+{
+    const uint64_t row0 = 0x1111111111111111ULL;
+    for (int j = 0; j < 8; ++j)
+    {
+        uint64_t x = q[j];
+        q[j] = (x & row0) | rotateLanes16(x & (row0 << 1), 4) |
+               rotateLanes16(x & (row0 << 2), 8) | rotateLanes16(x & (row0 << 3), 12);
+    }
+}
+
+// Row r of every column takes the value of row r + 1 (or r + 2).
+inline uint64_t rotateColumn1(uint64_t x)
+{
+    return ((x >> 1) & 0x7777777777777777ULL) | ((x << 3) & 0x8888888888888888ULL);
+}
+
+inline uint64_t rotateColumn2(uint64_t x)
+{
+    return ((x >> 2) & 0x3333333333333333ULL) | ((x << 2) & 0xCCCCCCCCCCCCCCCCULL);
+}
+
+// b = 2a + 3 rot1(a) + rot2(a) + rot3(a) = xtime(t) + rot1(a) + rot2(t)
+// with t = a + rot1(a).
+void mixColumnsBitsliced(uint64_t q[8])
+{
+    uint64_t r1[8];
+    uint64_t t[8];
+    for (int j = 0; j < 8; ++j)
+    {
+        r1[j] = rotateColumn1(q[j]);
+        t[j] = q[j] ^ r1[j];
+    }
+
+    uint64_t xt[8];
+    xt[0] = t[7];
+    xt[1] = t[0] ^ t[7];
+    xt[2] = t[1];
+    xt[3] = t[2] ^ t[7];
+    xt[4] = t[3] ^ t[7];
+    xt[5] = t[4];
+    xt[6] = t[5];
+    xt[7] = t[6];
+
+    for (int j = 0; j < 8; ++j)
+    {
+        q[j] = xt[j] ^ r1[j] ^ rotateColumn2(t[j]);
+    }
+}
+
+inline void addRoundKeyBitsliced(uint64_t q[8], const uint64_t *sk)
+{
+    for (int j = 0; j < 8; ++j)
+    {
+        q[j] ^= sk[j];
+    }
+}
+
+void encryptBitsliced(const uint64_t *sk, int rounds, uint64_t q[8])
+{
+    addRoundKeyBitsliced(q, sk);
+    for (int r = 1; r < rounds; ++r)
+    {
+        subBytesBitsliced(q);
+        shiftRowsBitsliced(q);
+        mixColumnsBitsliced(q);
+        addRoundKeyBitsliced(q, sk + 8 * r);
+    }
+    subBytesBitsliced(q);
+    shiftRowsBitsliced(q);
+    addRoundKeyBitsliced(q, sk + 8 * rounds);
+}
+
+void ctrBitsliced(const uint64_t *sk, int rounds, uint8_t *out, const uint8_t *in,
+                  std::size_t blocks, uint8_t counter[16])
+{
+    uint8_t keystream[64];
+    uint64_t q[8];
+    while (blocks > 0)
+    {
+        std::size_t n = std::min<std::size_t>(blocks, 4);
+        for (int b = 0; b < 4; ++b)
+        {
+            std::memcpy(keystream + 16 * b, counter, 16);
+            if (static_cast<std::size_t>(b) < n)
+            {
+                increment32(counter);
+            }
+        }
+        pack(q, keystream);
+        encryptBitsliced(sk, rounds, q);
+        unpack(keystream, q);
+        for (std::size_t i = 0; i < 16 * n; ++i)
+        {
+            out[i] = in[i] ^ keystream[i];
+        }
+        in += 16 * n;
+        out += 16 * n;
+        blocks -= n;
+    }
+}
+
+// S-box on the four bytes of a word via the bitsliced circuit, so the key
+// schedule does not index tables with key bytes either.
+uint32_t subWord(uint32_t w)
+{
+    uint8_t bytes[64] = {};
+    store32be(bytes, w);
+    uint64_t q[8];
+    pack(q, bytes);
+    subBytesBitsliced(q);
+    unpack(bytes, q);
+    return load32be(bytes);
+}
+
+// ---------------------------------------------------------------------------
+// GHASH helpers shared by the constant-time and carry-less multiply paths.
+//
+// Field elements are two big-endian 64-bit halves (hi = first 8 bytes).
+// Given the three Karatsuba products of the bit-reflected halves, shift
+// the 256-bit product left by one and reduce modulo x^128 + x^7 + x^2 +
+// x + 1.
+
+inline void ghashReduce(uint64_t z0, uint64_t z0h, uint64_t z1, uint64_t z1h,
+                        uint64_t z2, uint64_t z2h, uint64_t &yLo, uint64_t &yHi)
+{
+    z2 ^= z0 ^ z1;
+    z2h ^= z0h ^ z1h;
+
+    uint64_t v0 = z0;
+    uint64_t v1 = z0h ^ z2;
+    uint64_t v2 = z1 ^ z2h;
+    uint64_t v3 = z1h;
+
+    v3 = (v3 << 1) | (v2 >> 63);
+    v2 = (v2 << 1) | (v1 >> 63);
+    v1 = (v1 << 1) | (v0 >> 63);
+    v0 = (v0 << 1);
+
+    v2 ^= v0 ^ (v0 >> 1) ^ (v0 >> 2) ^ (v0 >> 7);
+    v1 ^= (v0 << 63) ^ (v0 << 62) ^ (v0 << 57);
+    v3 ^= v1 ^ (v1 >> 1) ^ (v1 >> 2) ^ (v1 >> 7);
+    v2 ^= (v1 << 63) ^ (v1 << 62) ^ (v1 << 57);
+
+    yLo = v2;
+    yHi = v3;
+}
+
+inline uint64_t reverse64(uint64_t x)
+{
+    x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    x = ((x >> 8) & 0x00FF00FF00FF00FFULL) | ((x & 0x00FF00FF00FF00FFULL) << 8);
+    x = ((x >> 16) & 0x0000FFFF0000FFFFULL) | ((x & 0x0000FFFF0000FFFFULL) << 16);
+    return (x >> 32) | (x << 32);
+}
+
+// Low 64 bits of a carry-less product using integer multiplies on
+// operands with 3-bit holes, so carries cannot reach the next data bit.
+inline uint64_t clmulLow(uint64_t x, uint64_t y)
+{
+    const uint64_t m0 = 0x1111111111111111ULL;
+    const uint64_t m1 = 0x2222222222222222ULL;
+    const uint64_t m2 = 0x4444444444444444ULL;
+    const uint64_t m3 = 0x8888888888888888ULL;
+
+    uint64_t x0 = x & m0, x1 = x & m1, x2 = x & m2, x3 = x & m3;
+    uint64_t y0 = y & m0, y1 = y & m1, y2 = y & m2, y3 = y & m3;
+
+    uint64_t z0 = (x0 * y0) ^ (x1 * y3) ^ (x2 * y2) ^ (x3 * y1);
+    uint64_t z1 = (x0 * y1) ^ (x1 * y0) ^ (x2 * y3) ^ (x3 * y2);
+    uint64_t z2 = (x0 * y2) ^ (x1 * y1) ^ (x2 * y0) ^ (x3 * y3);
+    uint64_t z3 = (x0 * y3) ^ (x1 * y2) ^ (x2 * y1) ^ (x3 * y0);
+
+    return (z0 & m0) | (z1 & m1) | (z2 & m2) | (z3 & m3);
+}
+
+// Calls fn(yHi, yLo, blockHi, blockLo) for every 16-byte block of data,
+// zero-padding the last one.
+template <typename Fn>
+inline void forEachBlock(const uint8_t *data, std::size_t len, Fn &&fn)
+{
+    while (len >= 16)
+    {
+        fn(load64be(data), load64be(data + 8));
+        data += 16;
+        len -= 16;
+    }
+    if (len > 0)
+    {
+        uint8_t last[16] = {};
+        std::memcpy(last, data, len);
+        fn(load64be(last), load64be(last + 8));
+    }
+}
+
+void ghashConstantTime(uint64_t hHi, uint64_t hLo, uint8_t y[16], const uint8_t *data, std::size_t len)
+{
+    uint64_t yHi = load64be(y);
+    uint64_t yLo = load64be(y + 8);
+    const uint64_t hLoR = reverse64(hLo);
+    const uint64_t hHiR = reverse64(hHi);
+    const uint64_t hMid = hLo ^ hHi;
+    const uint64_t hMidR = hLoR ^ hHiR;
+
+    forEachBlock(data, len, [&](uint64_t bHi, uint64_t bLo)
+                 {
+                     yHi ^= bHi;
+                     yLo ^= bLo;
+                     uint64_t yLoR = reverse64(yLo);
+                     uint64_t yHiR = reverse64(yHi);
+                     uint64_t yMid = yLo ^ yHi;
+                     uint64_t yMidR = yLoR ^ yHiR;
+
+                     // High halves come from the bit-reversed operands.
+                     uint64_t z0 = clmulLow(yLo, hLo);
+                     uint64_t z1 = clmulLow(yHi, hHi);
+                     uint64_t z2 = clmulLow(yMid, hMid);
+                     uint64_t z0h = reverse64(clmulLow(yLoR, hLoR)) >> 1;
+                     uint64_t z1h = reverse64(clmulLow(yHiR, hHiR)) >> 1;
+                     uint64_t z2h = reverse64(clmulLow(yMidR, hMidR)) >> 1;
+                     ghashReduce(z0, z0h, z1, z1h, z2, z2h, yLo, yHi); });
+
+    store64be(y, yHi);
+    store64be(y + 8, yLo);
+}
+
+// Shoup's 4-bit table method (as in most portable TLS stacks).
+const uint64_t kLast4[16] = {
+    0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0};
+
+void ghashTableInit(uint64_t hHi, uint64_t hLo, uint64_t tableHi[16], uint64_t tableLo[16])
+{
+    tableHi[0] = 0;
+    tableLo[0] = 0;
+    tableHi[8] = hHi;
+    tableLo[8] = hLo;
+
+    uint64_t vh = hHi;
+    uint64_t vl = hLo;
+    for (int i = 4; i > 0; i >>= 1)
+    {
+        uint64_t t = (vl & 1) * 0xe1000000ULL;
+        vl = (vh << 63) | (vl >> 1);
+        vh = (vh >> 1) ^ (t << 32);
+        tableHi[i] = vh;
+        tableLo[i] = vl;
+    }
+    for (int i = 2; i <= 8; i *= 2)
+    {
+        for (int j = 1; j < i; ++j)
+        {
+            tableHi[i + j] = tableHi[i] ^ tableHi[j];
+            tableLo[i + j] = tableLo[i] ^ tableLo[j];
+        }
+    }
+}
+
+void ghashTable(const uint64_t tableHi[16], const uint64_t tableLo[16], uint8_t y[16],
+                const uint8_t *data, std::size_t len)
+{
+    uint8_t x[16];
+    std::memcpy(x, y, 16);
+
+    auto step = [&](uint64_t &zh, uint64_t &zl, unsigned nibble)
+    {
+        unsigned rem = unsigned(zl & 0xF);
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4) ^ (kLast4[rem] << 48);
+        zh ^= tableHi[nibble];
+        zl ^= tableLo[nibble];
+    };
+
+    forEachBlock(data, len, [&](uint64_t bHi, uint64_t bLo)
+                 {
+                     store64be(x, load64be(x) ^ bHi);
+                     store64be(x + 8, load64be(x + 8) ^ bLo);
+
+                     unsigned lo = x[15] & 0xF;
+                     uint64_t zh = tableHi[lo];
+                     uint64_t zl = tableLo[lo];
+                     for (int i = 15; i >= 0; --i)
+                     {
+                         lo = x[i] & 0xF;
+                         unsigned hi = (x[i] >> 4) & 0xF;
+                         if (i != 15)
+                         {
+                             step(zh, zl, lo);
+                         }
+                         step(zh, zl, hi);
+                     }
+                     store64be(x, zh);
+                     store64be(x + 8, zl); });
+
+    std::memcpy(y, x, 16);
+}
+
+// ---------------------------------------------------------------------------
+// Hardware backends. Compiled with per-function target attributes so the
+// rest of the binary keeps the baseline -march.
+
+#if defined(AES_HW_X86)
+
+bool hardwareSupported()
+{
+    return cpu::features().aes && cpu::features().clmul;
+}
+
+const char *hardwareLabel() { return "AES-NI"; }
+
+__attribute__((target("aes,sse2")))
+void ctrHardware(const uint8_t *keys, int rounds, uint8_t *out, const uint8_t *in,
+                 std::size_t blocks, uint8_t counter[16])
+{
+    __m128i k[15];
+    for (int r = 0; r <= rounds; ++r)
+    {
+        k[r] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + 16 * r));
+    }
+
+    uint8_t ctrBlocks[4][16];
+    while (blocks > 0)
+    {
+        // Four independent blocks keep the AESENC pipeline busy.
+        std::size_t n = std::min<std::size_t>(blocks, 4);
+        __m128i b[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            std::memcpy(ctrBlocks[i], counter, 16);
+            if (static_cast<std::size_t>(i) < n)
+            {
+                increment32(counter);
+            }
+            b[i] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrBlocks[i])), k[0]);
+        }
+        for (int r = 1; r < rounds; ++r)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                b[i] = _mm_aesenc_si128(b[i], k[r]);
+            }
+        }
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            __m128i ks = _mm_aesenclast_si128(b[i], k[rounds]);
+            __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 16 * i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16 * i), _mm_xor_si128(data, ks));
+        }
+        in += 16 * n;
+        out += 16 * n;
+        blocks -= n;
+    }
+}
+
+__attribute__((target("pclmul,sse2")))
+inline void clmulHardware(uint64_t a, uint64_t b, uint64_t &lo, uint64_t &hi)
+{
+    __m128i r = _mm_clmulepi64_si128(_mm_cvtsi64_si128(static_cast<long long>(a)),
+                                     _mm_cvtsi64_si128(static_cast<long long>(b)), 0x00);
+    lo = static_cast<uint64_t>(_mm_cvtsi128_si64(r));
+    hi = static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_srli_si128(r, 8)));
+}
+
+#define AES_CLMUL_TARGET __attribute__((target("pclmul,sse2")))
+
+#elif defined(AES_HW_ARM)
+
+bool hardwareSupported()
+{
+    return cpu::features().aes && cpu::features().clmul;
+}
+
+const char *hardwareLabel() { return "ARMv8-CE"; }
+
+__attribute__((target("+crypto")))
+void ctrHardware(const uint8_t *keys, int rounds, uint8_t *out, const uint8_t *in,
+                 std::size_t blocks, uint8_t counter[16])
+{
+    uint8x16_t k[15];
+    for (int r = 0; r <= rounds; ++r)
+    {
+        k[r] = vld1q_u8(keys + 16 * r);
+    }
+
+    uint8_t ctrBlocks[4][16];
+    while (blocks > 0)
+    {
+        std::size_t n = std::min<std::size_t>(blocks, 4);
+        uint8x16_t b[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            std::memcpy(ctrBlocks[i], counter, 16);
+            if (static_cast<std::size_t>(i) < n)
+            {
+                increment32(counter);
+            }
+            b[i] = vld1q_u8(ctrBlocks[i]);
+        }
+        // AESE folds AddRoundKey in front of SubBytes/ShiftRows.
+        for (int r = 0; r < rounds - 1; ++r)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                b[i] = vaesmcq_u8(vaeseq_u8(b[i], k[r]));
+            }
+        }
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            uint8x16_t ks = veorq_u8(vaeseq_u8(b[i], k[rounds - 1]), k[rounds]);
+            vst1q_u8(out + 16 * i, veorq_u8(vld1q_u8(in + 16 * i), ks));
+        }
+        in += 16 * n;
+        out += 16 * n;
+        blocks -= n;
+    }
+}
+
+__attribute__((target("+crypto")))
+inline void clmulHardware(uint64_t a, uint64_t b, uint64_t &lo, uint64_t &hi)
+{
+    uint64x2_t r = vreinterpretq_u64_p128(vmull_p64(static_cast<poly64_t>(a), static_cast<poly64_t>(b)));
+    lo = vgetq_lane_u64(r, 0);
+    hi = vgetq_lane_u64(r, 1);
+}
+
+#define AES_CLMUL_TARGET __attribute__((target("+crypto")))
+
+#else
+
+bool hardwareSupported() { return false; }
+
+const char *hardwareLabel() { return "hardware"; }
+
+#endif
+
+#if defined(AES_CLMUL_TARGET)
+
+AES_CLMUL_TARGET
+void ghashHardware(uint64_t hHi, uint64_t hLo, uint8_t y[16], const uint8_t *data, std::size_t len)
+{
+    uint64_t yHi = load64be(y);
+    uint64_t yLo = load64be(y + 8);
+    const uint64_t hMid = hLo ^ hHi;
+
+    while (len > 0)
+    {
+        uint8_t last[16] = {};
+        const uint8_t *block = data;
+        std::size_t take = std::min<std::size_t>(len, 16);
+        if (take < 16)
+        {
+            std::memcpy(last, data, take);
+            block = last;
+        }
+        yHi ^= load64be(block);
+        yLo ^= load64be(block + 8);
+
+        // The reflected representation makes every product one bit short,
+        // which ghashReduce() corrects with its shift.
+        uint64_t z0, z0h, z1, z1h, z2, z2h;
+        clmulHardware(yLo, hLo, z0, z0h);
+        clmulHardware(yHi, hHi, z1, z1h);
+        clmulHardware(yLo ^ yHi, hMid, z2, z2h);
+        ghashReduce(z0, z0h, z1, z1h, z2, z2h, yLo, yHi);
+
+        data += take;
+        len -= take;
+    }
+
+    store64be(y, yHi);
+    store64be(y + 8, yLo);
+}
+
+#undef AES_CLMUL_TARGET
+
+#endif
+
+} // namespace
+
+const char *backendName(Backend backend)
+{
+    switch (backend)
+    {
+    case Backend::Table:
+        return "table";
+    case Backend::Bitsliced:
+        return "bitsliced";
+    case Backend::Hardware:
+        return hardwareLabel();
+    }
+    return "unknown";
+}
+
+bool available(Backend backend)
+{
+    if (backend == Backend::Hardware)
+    {
+        static const bool supported = hardwareSupported();
+        return supported;
+    }
+    return true;
+}
+
+Context::Context(Backend backend, const uint8_t *key, std::size_t keyBytes)
+    : backend_(backend), rounds_(0), rk_(), sk_(), hwKeys_(), hHi_(0), hLo_(0),
+      hTableHi_(), hTableLo_()
+{
+    if (keyBytes != 16 && keyBytes != 32)
+    {
+        throw std::invalid_argument("AES key must be 16 or 32 bytes");
+    }
+    if (!available(backend))
+    {
+        throw std::runtime_error("AES backend not supported on this CPU");
+    }
+
+    // Standard key expansion, with SubWord done in constant time.
+    const int nk = static_cast<int>(keyBytes / 4);
+    rounds_ = nk + 6;
+    const int words = 4 * (rounds_ + 1);
+    for (int i = 0; i < nk; ++i)
+    {
+        rk_[i] = load32be(key + 4 * i);
+    }
+    uint8_t rcon = 1;
+    for (int i = nk; i < words; ++i)
+    {
+        uint32_t temp = rk_[i - 1];
+        if (i % nk == 0)
+        {
+            temp = subWord((temp << 8) | (temp >> 24)) ^ (uint32_t(rcon) << 24);
+            rcon = xtime(rcon);
+        }
+        else if (nk > 6 && i % nk == 4)
+        {
+            temp = subWord(temp);
+        }
+        rk_[i] = rk_[i - nk] ^ temp;
+    }
+
+    for (int i = 0; i < words; ++i)
+    {
+        store32be(hwKeys_ + 4 * i, rk_[i]);
+    }
+
+    // Bit-plane round keys: each round key repeated for all four blocks.
+    for (int r = 0; r <= rounds_; ++r)
+    {
+        uint8_t repeated[64];
+        for (int b = 0; b < 4; ++b)
+        {
+            std::memcpy(repeated + 16 * b, hwKeys_ + 16 * r, 16);
+        }
+        pack(sk_ + 8 * r, repeated);
+    }
+
+    uint8_t zero[16] = {};
+    uint8_t h[16];
+    encryptBlock(h, zero);
+    hHi_ = load64be(h);
+    hLo_ = load64be(h + 8);
+    ghashTableInit(hHi_, hLo_, hTableHi_, hTableLo_);
+}
+
+void Context::ctrBlocks(uint8_t *out, const uint8_t *in, std::size_t blocks, uint8_t counter[16]) const
+{
+    switch (backend_)
+    {
+    case Backend::Table:
+        ctrTable(rk_, rounds_, out, in, blocks, counter);
+        break;
+    case Backend::Bitsliced:
+        ctrBitsliced(sk_, rounds_, out, in, blocks, counter);
+        break;
+    case Backend::Hardware:
+#if defined(AES_HW_X86) || defined(AES_HW_ARM)
+        ctrHardware(hwKeys_, rounds_, out, in, blocks, counter);
+#endif
+        break;
+    }
+}
+
+void Context::ghash(uint8_t y[16], const uint8_t *data, std::size_t len) const
+{
+    switch (backend_)
+    {
+    case Backend::Table:
+        ghashTable(hTableHi_, hTableLo_, y, data, len);
+        break;
+    case Backend::Bitsliced:
+        ghashConstantTime(hHi_, hLo_, y, data, len);
+        break;
+    case Backend::Hardware:
+#if defined(AES_HW_X86) || defined(AES_HW_ARM)
+        ghashHardware(hHi_, hLo_, y, data, len);
+#endif
+        break;
+    }
+}
+
+void Context::encryptBlock(uint8_t out[16], const uint8_t in[16]) const
+{
+    // A single block is CTR with the input as the counter and zero data.
+    uint8_t counter[16];
+    uint8_t zero[16] = {};
+    std::memcpy(counter, in, 16);
+    if (backend_ == Backend::Table)
+    {
+        encryptTable(rk_, rounds_, in, out);
+        return;
+    }
+    ctrBlocks(out, zero, 1, counter);
+}
+
+void Context::ctr(uint8_t *out, const uint8_t *in, std::size_t len, const uint8_t iv[16]) const
+{
+    uint8_t counter[16];
+    std::memcpy(counter, iv, 16);
+
+    std::size_t blocks = len / 16;
+    ctrBlocks(out, in, blocks, counter);
+
+    std::size_t tail = len % 16;
+    if (tail > 0)
+    {
+        uint8_t pad[16] = {};
+        std::memcpy(pad, in + 16 * blocks, tail);
+        ctrBlocks(pad, pad, 1, counter);
+        std::memcpy(out + 16 * blocks, pad, tail);
+    }
+}
+
+void Context::gcmEncrypt(uint8_t *out, uint8_t tag[16], const uint8_t *in, std::size_t len,
+                         const uint8_t iv[12], const uint8_t *aad, std::size_t aadLen) const
+{
+    uint8_t j0[16];
+    std::memcpy(j0, iv, 12);
+    store32be(j0 + 12, 1);
+
+    uint8_t counter[16];
+    std::memcpy(counter, j0, 16);
+    increment32(counter);
+
+    uint8_t y[16] = {};
+    ghash(y, aad, aadLen);
+
+    // Encrypt and authenticate in chunks so the ciphertext is still in L1
+    // when GHASH reads it back.
+    const std::size_t chunk = 4096;
+    for (std::size_t done = 0; done < len; done += chunk)
+    {
+        std::size_t n = std::min(chunk, len - done);
+        std::size_t blocks = n / 16;
+        ctrBlocks(out + done, in + done, blocks, counter);
+        if (n % 16 != 0)
+        {
+            uint8_t pad[16] = {};
+            std::memcpy(pad, in + done + 16 * blocks, n % 16);
+            ctrBlocks(pad, pad, 1, counter);
+            std::memcpy(out + done + 16 * blocks, pad, n % 16);
+        }
+        ghash(y, out + done, n);
+    }
+
+    uint8_t lengths[16];
+    store64be(lengths, uint64_t(aadLen) * 8);
+    store64be(lengths + 8, uint64_t(len) * 8);
+    ghash(y, lengths, 16);
+
+    uint8_t mask[16];
+    encryptBlock(mask, j0);
+    for (int i = 0; i < 16; ++i)
+    {
+        tag[i] = y[i] ^ mask[i];
+    }
+}
+
+} // namespace aes
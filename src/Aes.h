@@ -0,0 +1,60 @@
+// Aes.h
+// AES-128/256 in CTR and GCM modes with three interchangeable backends,
+// used by the AES encryption benchmark.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace aes {
+
+enum class Backend {
+    Table,     // Portable T-table implementation (fast, not constant-time)
+    Bitsliced, // Portable constant-time version, four blocks per pass
+    Hardware   // AES-NI + PCLMUL on x86-64, Crypto Extensions on AArch64
+};
+
+// Short name for reports: "table", "bitsliced", "AES-NI", "ARMv8-CE".
+const char *backendName(Backend backend);
+
+// Whether this build and the CPU it runs on support the backend. Checked
+// at runtime, so a generic binary still uses the hardware where present.
+bool available(Backend backend);
+
+class Context {
+public:
+    // keyBytes must be 16 (AES-128) or 32 (AES-256).
+    Context(Backend backend, const uint8_t *key, std::size_t keyBytes);
+
+    Backend backend() const { return backend_; }
+
+    void encryptBlock(uint8_t out[16], const uint8_t in[16]) const;
+
+    // CTR mode with a full 16-byte initial counter block. Like GCM, only
+    // the last 32 bits are incremented. Encryption and decryption are the
+    // same operation; out may equal in.
+    void ctr(uint8_t *out, const uint8_t *in, std::size_t len, const uint8_t iv[16]) const;
+
+    // GCM encryption with a 96-bit IV and a full 16-byte tag.
+    void gcmEncrypt(uint8_t *out, uint8_t tag[16], const uint8_t *in, std::size_t len,
+                    const uint8_t iv[12], const uint8_t *aad, std::size_t aadLen) const;
+
+private:
+    // Encrypts `blocks` consecutive counter blocks and XORs them into in,
+    // advancing counter.
+    void ctrBlocks(uint8_t *out, const uint8_t *in, std::size_t blocks, uint8_t counter[16]) const;
+    // Folds len bytes (zero-padded to a block) into the GHASH state y.
+    void ghash(uint8_t y[16], const uint8_t *data, std::size_t len) const;
+
+    Backend backend_;
+    int rounds_;
+    uint32_t rk_[60];          // Round keys as big-endian words
+    uint64_t sk_[15 * 8];      // Round keys as bit planes (bitsliced)
+    alignas(16) uint8_t hwKeys_[15 * 16];
+    uint64_t hHi_, hLo_;       // GHASH key H, big-endian halves
+    uint64_t hTableHi_[16];    // 4-bit multiples of H (table backend)
+    uint64_t hTableLo_[16];
+};
+
+} // namespace aes
@@ -0,0 +1,506 @@
+// Alloc.cpp
+// Arena and pool allocators, the stress workloads and /proc memory probes.
+
+#include "Alloc.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace alloc {
+
+namespace {
+
+constexpr std::size_t kAlign = 16;
+constexpr std::size_t kPageBytes = 4096;
+
+// Pool that belongs to the calling thread, if any; frees from that thread
+// skip the atomic remote list.
+thread_local Pool *currentPool = nullptr;
+
+void stamp(void *p, std::size_t bytes, uint64_t value)
+{
+    std::memcpy(p, &value, sizeof(value));
+    std::memcpy(static_cast<char *>(p) + bytes - sizeof(value), &value, sizeof(value));
+}
+
+bool stampIntact(const void *p, std::size_t bytes, uint64_t value)
+{
+    uint64_t head, tail;
+    std::memcpy(&head, p, sizeof(head));
+    std::memcpy(&tail, static_cast<const char *>(p) + bytes - sizeof(tail), sizeof(tail));
+    return head == value && tail == value;
+}
+
+// Block sizes cycled through by a workload, drawn before timing so the
+// RNG stays out of the measured loop.
+std::vector<uint32_t> logUniformSizes(std::size_t count, double lo, double hi, uint32_t seed)
+{
+    std::mt19937 engine(seed);
+    std::uniform_real_distribution<double> exponent(std::log(lo), std::log(hi));
+    std::vector<uint32_t> sizes(count);
+    for (uint32_t &s : sizes)
+    {
+        s = uint32_t(std::exp(exponent(engine)));
+    }
+    return sizes;
+}
+
+// The three kinds behind one interface for the workload templates. The
+// slot argument only matters to the arena: consecutive frames alternate
+// between two arenas so one can be reset while the other is still live.
+struct MallocHeap {
+    void *allocate(std::size_t bytes, int) { return std::malloc(bytes); }
+    void free(void *p) { std::free(p); }
+    void endFrame(int) {}
+};
+
+struct PoolHeap {
+    Pool pool;
+
+    void *allocate(std::size_t bytes, int) { return pool.allocate(bytes); }
+    void free(void *p) { Pool::deallocate(p); }
+    void endFrame(int) {}
+};
+
+struct ArenaHeap {
+    Arena arenas[2];
+
+    explicit ArenaHeap(std::size_t chunkBytes) : arenas{Arena(chunkBytes), Arena(chunkBytes)} {}
+
+    void *allocate(std::size_t bytes, int slot) { return arenas[slot].allocate(bytes); }
+    void free(void *) {}
+    void endFrame(int slot) { arenas[slot].reset(); }
+};
+
+struct Block {
+    void *p;
+    uint32_t bytes;
+    uint64_t stamp;
+};
+
+// Allocates frames of frameSize blocks. With overlap a frame is released
+// after the next one is allocated, otherwise straight away.
+template <typename Heap>
+std::size_t runFrames(Heap &heap, const std::vector<uint32_t> &sizes, std::size_t allocations, std::size_t frameSize,
+                      bool overlap, bool touchPages)
+{
+    std::vector<Block> frames[2];
+    frames[0].reserve(frameSize);
+    frames[1].reserve(frameSize);
+    std::size_t corrupted = 0;
+
+    auto release = [&](int slot)
+    {
+        for (const Block &b : frames[slot])
+        {
+            corrupted += !stampIntact(b.p, b.bytes, b.stamp);
+            heap.free(b.p);
+        }
+        frames[slot].clear();
+        heap.endFrame(slot);
+    };
+
+    uint64_t next = 0;
+    for (std::size_t frame = 0; next < allocations; ++frame)
+    {
+        const int slot = overlap ? int(frame % 2) : 0;
+        const std::size_t count = std::min<std::size_t>(frameSize, allocations - next);
+        for (std::size_t i = 0; i < count; ++i, ++next)
+        {
+            const uint32_t bytes = sizes[next % sizes.size()];
+            char *p = static_cast<char *>(heap.allocate(bytes, slot));
+            if (!p)
+            {
+                throw std::bad_alloc();
+            }
+            if (touchPages)
+            {
+                for (std::size_t offset = 0; offset < bytes; offset += kPageBytes)
+                {
+                    p[offset] = 1;
+                }
+            }
+            stamp(p, bytes, next);
+            frames[slot].push_back({p, bytes, next});
+        }
+        release(overlap ? slot ^ 1 : slot);
+    }
+    release(0);
+    release(1);
+    return corrupted;
+}
+
+template <typename Workload>
+std::size_t withHeap(Kind kind, std::size_t arenaChunkBytes, Workload &&workload)
+{
+    switch (kind)
+    {
+    case Kind::Malloc:
+    {
+        MallocHeap heap;
+        return workload(heap);
+    }
+    case Kind::Arena:
+    {
+        ArenaHeap heap(arenaChunkBytes);
+        return workload(heap);
+    }
+    case Kind::Pool:
+    {
+        PoolHeap heap;
+        return workload(heap);
+    }
+    }
+    return 0;
+}
+
+std::size_t statusField(const char *field)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    const std::size_t length = std::strlen(field);
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, length, field) == 0 && line.size() > length && line[length] == ':')
+        {
+            return std::size_t(std::stoull(line.substr(length + 1))) * 1024; // Reported in kB
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+const char *kindName(Kind kind)
+{
+    switch (kind)
+    {
+    case Kind::Malloc:
+        return "malloc";
+    case Kind::Arena:
+        return "arena";
+    case Kind::Pool:
+        return "pool";
+    }
+    return "unknown";
+}
+
+Arena::Arena(std::size_t chunkBytes) : chunkBytes_(chunkBytes) {}
+
+Arena::~Arena()
+{
+    for (const Chunk &c : chunks_)
+    {
+        std::free(c.base);
+    }
+}
+
+void *Arena::allocate(std::size_t bytes)
+{
+    bytes = (bytes + kAlign - 1) & ~(kAlign - 1);
+    // Chunks too small for this block are skipped for the rest of the
+    // round rather than split.
+    for (; current_ < chunks_.size(); ++current_, used_ = 0)
+    {
+        if (chunks_[current_].size - used_ >= bytes)
+        {
+            void *p = chunks_[current_].base + used_;
+            used_ += bytes;
+            return p;
+        }
+    }
+
+    const std::size_t size = std::max(chunkBytes_, bytes);
+    char *base = static_cast<char *>(std::malloc(size));
+    if (!base)
+    {
+        throw std::bad_alloc();
+    }
+    chunks_.push_back({base, size});
+    current_ = chunks_.size() - 1;
+    used_ = bytes;
+    return base;
+}
+
+void Arena::reset()
+{
+    current_ = 0;
+    used_ = 0;
+}
+
+Pool::Pool()
+{
+    currentPool = this;
+}
+
+Pool::~Pool()
+{
+    if (currentPool == this)
+    {
+        currentPool = nullptr;
+    }
+    for (void *chunk : chunks_)
+    {
+        std::free(chunk);
+    }
+}
+
+void *Pool::allocate(std::size_t bytes)
+{
+    const std::size_t total = bytes + sizeof(Header);
+    if (total > (kMinBlock << (kClasses - 1)))
+    {
+        Header *h = static_cast<Header *>(std::malloc(total));
+        if (!h)
+        {
+            throw std::bad_alloc();
+        }
+        h->owner = nullptr;
+        return h + 1;
+    }
+
+    // Smallest class with kMinBlock << c >= total.
+    const int c = total <= kMinBlock ? 0 : int(sizeof(unsigned long long) * 8) - __builtin_clzll(total - 1) - 4;
+    if (!free_[c])
+    {
+        drainRemote();
+    }
+    if (Node *n = free_[c])
+    {
+        free_[c] = n->next;
+        return n;
+    }
+
+    Header *h = reinterpret_cast<Header *>(carve(kMinBlock << c));
+    h->owner = this;
+    h->sizeClass = uint32_t(c);
+    return h + 1;
+}
+
+void Pool::deallocate(void *p)
+{
+    if (!p)
+    {
+        return;
+    }
+    Header *h = static_cast<Header *>(p) - 1;
+    Pool *owner = h->owner;
+    if (!owner)
+    {
+        std::free(h);
+        return;
+    }
+
+    Node *n = static_cast<Node *>(p);
+    if (owner == currentPool)
+    {
+        n->next = owner->free_[h->sizeClass];
+        owner->free_[h->sizeClass] = n;
+        return;
+    }
+    n->next = owner->remote_.load(std::memory_order_relaxed);
+    while (!owner->remote_.compare_exchange_weak(n->next, n, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+}
+
+char *Pool::carve(std::size_t block)
+{
+    if (block >= kSlabBytes)
+    {
+        void *p = std::malloc(block);
+        if (!p)
+        {
+            throw std::bad_alloc();
+        }
+        chunks_.push_back(p);
+        return static_cast<char *>(p);
+    }
+    // The tail of the previous slab is abandoned.
+    if (std::size_t(limit_ - cursor_) < block)
+    {
+        void *slab = std::malloc(kSlabBytes);
+        if (!slab)
+        {
+            throw std::bad_alloc();
+        }
+        chunks_.push_back(slab);
+        cursor_ = static_cast<char *>(slab);
+        limit_ = cursor_ + kSlabBytes;
+    }
+    char *p = cursor_;
+    cursor_ += block;
+    return p;
+}
+
+// Takes the whole remote list at once, so there is no ABA problem.
+void Pool::drainRemote()
+{
+    Node *n = remote_.exchange(nullptr, std::memory_order_acquire);
+    while (n)
+    {
+        Node *next = n->next;
+        const uint32_t c = (reinterpret_cast<Header *>(n) - 1)->sizeClass;
+        n->next = free_[c];
+        free_[c] = n;
+        n = next;
+    }
+}
+
+std::size_t smallChurn(Kind kind, std::size_t allocations, uint32_t seed)
+{
+    const std::vector<uint32_t> sizes = logUniformSizes(4096, 16, 256, seed);
+    return withHeap(kind, 256 * 1024, [&](auto &heap)
+                    { return runFrames(heap, sizes, allocations, 1024, true, false); });
+}
+
+std::size_t largeReuse(Kind kind, std::size_t allocations, uint32_t seed)
+{
+    const std::vector<uint32_t> sizes = logUniformSizes(256, 64 * 1024, 4 * 1024 * 1024, seed);
+    return withHeap(kind, 4 * 1024 * 1024, [&](auto &heap)
+                    { return runFrames(heap, sizes, allocations, 4, false, true); });
+}
+
+// Single-producer single-consumer ring of batches.
+struct Handoff::Mailbox {
+    static constexpr std::size_t kSlots = 16;
+    static constexpr std::size_t kBatch = 64;
+
+    struct Batch {
+        std::size_t count;
+        void *blocks[kBatch];
+        uint32_t bytes[kBatch];
+        uint64_t stamps[kBatch];
+    };
+
+    Batch slots[kSlots];
+    alignas(64) std::atomic<std::size_t> head{0}; // Written by the producer
+    alignas(64) std::atomic<std::size_t> tail{0}; // Written by the consumer
+};
+
+Handoff::Handoff(int threads) : threads_(threads), done_(threads)
+{
+    for (int r = 0; r < threads; ++r)
+    {
+        mailboxes_.push_back(std::make_unique<Mailbox>());
+    }
+}
+
+Handoff::~Handoff() = default;
+
+std::size_t Handoff::run(Kind kind, int rank, std::size_t allocations, uint32_t seed)
+{
+    switch (kind)
+    {
+    case Kind::Malloc:
+    {
+        MallocHeap heap;
+        return exchange(heap, rank, allocations, seed);
+    }
+    case Kind::Pool:
+    {
+        // Other ranks free into this pool until they are all done.
+        PoolHeap heap;
+        return exchange(heap, rank, allocations, seed);
+    }
+    case Kind::Arena:
+        break;
+    }
+    throw std::invalid_argument("Handoff needs an allocator that frees single blocks");
+}
+
+// Alternates between filling a batch for the next rank and freeing one
+// from the previous rank, so a full outbox never deadlocks the ring.
+template <typename Heap>
+std::size_t Handoff::exchange(Heap &heap, int rank, std::size_t allocations, uint32_t seed)
+{
+    Mailbox &out = *mailboxes_[rank];
+    Mailbox &in = *mailboxes_[(rank + threads_ - 1) % threads_];
+    const std::vector<uint32_t> sizes = logUniformSizes(4096, 16, 4096, seed);
+    const uint64_t tag = uint64_t(rank) << 40;
+
+    std::size_t produced = 0, consumed = 0, corrupted = 0;
+    while (produced < allocations || consumed < allocations)
+    {
+        bool progress = false;
+
+        const std::size_t head = out.head.load(std::memory_order_relaxed);
+        if (produced < allocations && head - out.tail.load(std::memory_order_acquire) < Mailbox::kSlots)
+        {
+            Mailbox::Batch &batch = out.slots[head % Mailbox::kSlots];
+            batch.count = std::min(Mailbox::kBatch, allocations - produced);
+            for (std::size_t i = 0; i < batch.count; ++i, ++produced)
+            {
+                const uint32_t bytes = sizes[produced % sizes.size()];
+                void *p = heap.allocate(bytes, 0);
+                if (!p)
+                {
+                    throw std::bad_alloc();
+                }
+                stamp(p, bytes, tag | produced);
+                batch.blocks[i] = p;
+                batch.bytes[i] = bytes;
+                batch.stamps[i] = tag | produced;
+            }
+            out.head.store(head + 1, std::memory_order_release);
+            progress = true;
+        }
+
+        const std::size_t tail = in.tail.load(std::memory_order_relaxed);
+        if (tail != in.head.load(std::memory_order_acquire))
+        {
+            const Mailbox::Batch &batch = in.slots[tail % Mailbox::kSlots];
+            for (std::size_t i = 0; i < batch.count; ++i)
+            {
+                corrupted += !stampIntact(batch.blocks[i], batch.bytes[i], batch.stamps[i]);
+                heap.free(batch.blocks[i]);
+            }
+            consumed += batch.count;
+            in.tail.store(tail + 1, std::memory_order_release);
+            progress = true;
+        }
+
+        if (!progress)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    done_.wait();
+    return corrupted;
+}
+
+std::size_t residentBytes()
+{
+    return statusField("VmRSS");
+}
+
+std::size_t peakResidentBytes()
+{
+    return statusField("VmHWM");
+}
+
+bool resetPeakResident()
+{
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+    clearRefs.flush();
+    return bool(clearRefs);
+}
+
+} // namespace alloc
@@ -0,0 +1,142 @@
+// Alloc.h
+// Bump arena and per-thread size-class pool allocators, the workloads of
+// the allocator stress benchmark and resident-memory probes.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Barrier.h"
+
+namespace alloc {
+
+enum class Kind {
+    Malloc, // System malloc/free
+    Arena,  // Bump allocation, freed a whole frame at a time
+    Pool    // Per-thread size-class free lists
+};
+
+const char *kindName(Kind kind);
+
+// Bump allocator over a list of chunks. Blocks are 16-byte aligned and
+// cannot be freed one by one; reset() rewinds to the first chunk and
+// keeps the memory for the next round.
+class Arena {
+public:
+    explicit Arena(std::size_t chunkBytes);
+    ~Arena();
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(std::size_t bytes);
+    void reset();
+
+private:
+    struct Chunk {
+        char *base;
+        std::size_t size;
+    };
+
+    std::size_t chunkBytes_;
+    std::vector<Chunk> chunks_;
+    std::size_t current_{0}; // Chunk being carved
+    std::size_t used_{0};    // Bytes used in chunks_[current_]
+};
+
+// Size-class allocator owned by the thread that created it: power-of-two
+// blocks from 16 B to 8 MB (header included), bigger requests go straight
+// to malloc. A 16-byte header in front of each block names its pool, so
+// any thread can free it. The owner pushes onto its own free list; other
+// threads push onto the owner's lock-free remote list, which the owner
+// takes over in one exchange when a class runs dry.
+//
+// Memory goes back to the system only when the pool is destroyed, which
+// must happen after every thread has stopped freeing into it.
+class Pool {
+public:
+    Pool();
+    ~Pool();
+    Pool(const Pool &) = delete;
+    Pool &operator=(const Pool &) = delete;
+
+    void *allocate(std::size_t bytes);
+    // Any thread, any pool's block (or nullptr).
+    static void deallocate(void *p);
+
+private:
+    struct Node {
+        Node *next;
+    };
+    struct alignas(16) Header {
+        Pool *owner; // nullptr for blocks from malloc
+        uint32_t sizeClass;
+    };
+
+    static constexpr std::size_t kMinBlock = 16;
+    static constexpr int kClasses = 20; // 16 B .. 8 MB
+    // Blocks below this are carved from shared slabs, the rest are
+    // allocated one by one.
+    static constexpr std::size_t kSlabBytes = 256 * 1024;
+
+    char *carve(std::size_t block);
+    void drainRemote();
+
+    Node *free_[kClasses] = {};
+    std::atomic<Node *> remote_{nullptr};
+    std::vector<void *> chunks_; // Slabs and big blocks, freed with the pool
+    char *cursor_{nullptr};
+    char *limit_{nullptr};
+};
+
+// Workloads. Every block gets a stamp at both ends that is checked before
+// it is freed; each function returns the number of blocks whose stamp
+// had been overwritten (0 unless the allocator handed out overlapping
+// memory). Sizes are drawn log-uniformly.
+
+// Small-object churn: frames of 1024 blocks of 16-256 B. Each frame is
+// freed after the next one has been allocated (the arena kind uses two
+// arenas in turn).
+std::size_t smallChurn(Kind kind, std::size_t allocations, uint32_t seed);
+
+// Large-block reuse: frames of four 64 KB - 4 MB blocks with one write
+// per 4 KB page, freed at the end of each frame.
+std::size_t largeReuse(Kind kind, std::size_t allocations, uint32_t seed);
+
+// Producer/consumer frees: threads form a ring, and each one allocates
+// 16 B - 4 KB blocks in batches of 64 and hands them to the next thread,
+// which frees them. Every rank calls run(); it returns once all ranks
+// are done. Malloc and Pool only, since an arena cannot free single
+// blocks.
+class Handoff {
+public:
+    explicit Handoff(int threads);
+    ~Handoff();
+
+    std::size_t run(Kind kind, int rank, std::size_t allocations, uint32_t seed);
+
+private:
+    struct Mailbox;
+
+    template <typename Heap>
+    std::size_t exchange(Heap &heap, int rank, std::size_t allocations, uint32_t seed);
+
+    int threads_;
+    std::vector<std::unique_ptr<Mailbox>> mailboxes_; // mailboxes_[r]: rank r -> r + 1
+    Barrier done_;
+};
+
+// Resident set size and its high-water mark (VmRSS / VmHWM in
+// /proc/self/status) in bytes, 0 where unavailable.
+std::size_t residentBytes();
+std::size_t peakResidentBytes();
+
+// Returns free heap memory to the system (glibc), then resets the
+// high-water mark to the current RSS through /proc/self/clear_refs
+// (Linux 4.0+). False if the mark could not be reset.
+bool resetPeakResident();
+
+} // namespace alloc
@@ -0,0 +1,36 @@
+// Barrier.h
+// Reusable thread barrier for benchmarks where several threads cooperate
+// on one problem (std::barrier only arrives with C++20).
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+class Barrier {
+public:
+    explicit Barrier(int count) : count_(count) {}
+
+    // Blocks until `count` threads have called wait(), then releases them
+    // all. Can be reused straight away for the next phase.
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        unsigned generation = generation_;
+        if (++waiting_ == count_)
+        {
+            waiting_ = 0;
+            ++generation_;
+            cv_.notify_all();
+            return;
+        }
+        cv_.wait(lock, [this, generation]() { return generation != generation_; });
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int count_;
+    int waiting_{0};
+    unsigned generation_{0};
+};
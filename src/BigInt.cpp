@@ -0,0 +1,370 @@
+// BigInt.cpp
+// Multiprecision kernels: schoolbook/Karatsuba products and Montgomery
+// modular arithmetic on 32-bit and 64-bit limbs.
+
+#include "BigInt.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace bigint {
+
+namespace {
+
+// Double-width multiply-accumulate: returns the low limb of a * b + c + d
+// and stores the high limb in hi. The result always fits in two limbs.
+template <typename Limb>
+struct Wide;
+
+template <>
+struct Wide<uint32_t>
+{
+    static inline uint32_t mulAdd(uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t &hi)
+    {
+        uint64_t t = static_cast<uint64_t>(a) * b + c + d;
+        hi = static_cast<uint32_t>(t >> 32);
+        return static_cast<uint32_t>(t);
+    }
+};
+
+template <>
+struct Wide<uint64_t>
+{
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 uint128;
+
+    static inline uint64_t mulAdd(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t &hi)
+    {
+        uint128 t = static_cast<uint128>(a) * b + c + d;
+        hi = static_cast<uint64_t>(t >> 64);
+        return static_cast<uint64_t>(t);
+    }
+#else
+    // 32-bit targets (ARMv6/ARMv7) have no 64x64->128 multiply, so the
+    // product is assembled from four 32x32->64 partial products.
+    static inline uint64_t mulAdd(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t &hi)
+    {
+        const uint64_t mask = 0xffffffffu;
+        uint64_t aLo = a & mask, aHi = a >> 32;
+        uint64_t bLo = b & mask, bHi = b >> 32;
+
+        uint64_t ll = aLo * bLo;
+        uint64_t lh = aLo * bHi;
+        uint64_t hl = aHi * bLo;
+        uint64_t hh = aHi * bHi;
+
+        uint64_t mid = (ll >> 32) + (lh & mask) + (hl & mask);
+        uint64_t lo = (ll & mask) | (mid << 32);
+        uint64_t high = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+
+        lo += c;
+        high += (lo < c);
+        lo += d;
+        high += (lo < d);
+        hi = high;
+        return lo;
+    }
+#endif
+};
+
+template <typename Limb>
+constexpr unsigned limbBits() { return sizeof(Limb) * 8; }
+
+// r = |x - y|, returns true when x < y.
+template <typename Limb>
+bool absDiff(Limb *r, const Limb *x, const Limb *y, std::size_t n)
+{
+    if (compare(x, y, n) >= 0)
+    {
+        sub(r, x, y, n);
+        return false;
+    }
+    sub(r, y, x, n);
+    return true;
+}
+
+// Adds a small value into r[0, n), rippling the carry upwards.
+template <typename Limb>
+void propagate(Limb *r, std::size_t n, Limb value)
+{
+    for (std::size_t i = 0; i < n && value != 0; ++i)
+    {
+        Limb s = r[i] + value;
+        value = (s < value) ? 1 : 0;
+        r[i] = s;
+    }
+}
+
+} // namespace
+
+template <typename Limb>
+Limb add(Limb *r, const Limb *a, const Limb *b, std::size_t n)
+{
+    Limb carry = 0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        Limb ai = a[i];
+        Limb s = ai + b[i];
+        Limb c1 = (s < ai) ? 1 : 0;
+        Limb s2 = s + carry;
+        carry = c1 | ((s2 < s) ? 1 : 0);
+        r[i] = s2;
+    }
+    return carry;
+}
+
+template <typename Limb>
+Limb sub(Limb *r, const Limb *a, const Limb *b, std::size_t n)
+{
+    Limb borrow = 0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        Limb ai = a[i];
+        Limb bi = b[i];
+        Limb d = ai - bi;
+        Limb b1 = (ai < bi) ? 1 : 0;
+        Limb d2 = d - borrow;
+        borrow = b1 | ((d < borrow) ? 1 : 0);
+        r[i] = d2;
+    }
+    return borrow;
+}
+
+template <typename Limb>
+int compare(const Limb *a, const Limb *b, std::size_t n)
+{
+    for (std::size_t i = n; i-- > 0;)
+    {
+        if (a[i] != b[i])
+        {
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+template <typename Limb>
+void mulSchoolbook(Limb *r, const Limb *a, const Limb *b, std::size_t n)
+{
+    std::fill(r, r + 2 * n, Limb(0));
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        Limb carry = 0;
+        const Limb bi = b[i];
+        for (std::size_t j = 0; j < n; ++j)
+        {
+            r[i + j] = Wide<Limb>::mulAdd(a[j], bi, r[i + j], carry, carry);
+        }
+        r[i + n] = carry;
+    }
+}
+
+template <typename Limb>
+void mulKaratsuba(Limb *r, const Limb *a, const Limb *b, std::size_t n, Limb *scratch)
+{
+    if (n < kKaratsubaThreshold || (n & 1) != 0)
+    {
+        mulSchoolbook(r, a, b, n);
+        return;
+    }
+
+    // a = a1 * B^h + a0, b = b1 * B^h + b0 and
+    // a0*b1 + a1*b0 = z0 + z2 + (a0 - a1)(b1 - b0).
+    const std::size_t h = n / 2;
+    Limb *da = scratch;
+    Limb *db = scratch + h;
+    Limb *z1 = scratch + n;
+    Limb *next = scratch + 2 * n;
+
+    bool negA = absDiff(da, a, a + h, h);
+    bool negB = absDiff(db, b + h, b, h);
+
+    mulKaratsuba(r, a, b, h, next);             // z0 -> r[0, n)
+    mulKaratsuba(r + n, a + h, b + h, h, next); // z2 -> r[n, 2n)
+    mulKaratsuba(z1, da, db, h, next);          // |z1| -> n limbs
+
+    // The recursion is done with `next`, so reuse it for the middle term.
+    Limb *mid = next;
+    Limb carry = add(mid, r, r + n, n);
+    if (negA == negB)
+    {
+        carry += add(mid, mid, z1, n);
+    }
+    else
+    {
+        carry -= sub(mid, mid, z1, n);
+    }
+
+    Limb c = add(r + h, r + h, mid, n);
+    propagate(r + h + n, n - h, Limb(c + carry));
+}
+
+template <typename Limb>
+void modReference(Limb *r, const Limb *x, const Limb *m, std::size_t n)
+{
+    const unsigned bits = limbBits<Limb>();
+    std::vector<Limb> rem(n + 1, 0);
+    std::vector<Limb> mod(m, m + n);
+    mod.push_back(0);
+
+    for (std::size_t bit = 2 * n * bits; bit-- > 0;)
+    {
+        Limb in = (x[bit / bits] >> (bit % bits)) & 1;
+        for (std::size_t i = n + 1; i-- > 1;)
+        {
+            rem[i] = (rem[i] << 1) | (rem[i - 1] >> (bits - 1));
+        }
+        rem[0] = (rem[0] << 1) | in;
+        if (compare(rem.data(), mod.data(), n + 1) >= 0)
+        {
+            sub(rem.data(), rem.data(), mod.data(), n + 1);
+        }
+    }
+    std::copy(rem.begin(), rem.begin() + n, r);
+}
+
+template <typename Limb>
+Montgomery<Limb>::Montgomery(const std::vector<Limb> &modulus)
+    : n_(modulus.size()), m_(modulus), r2_(modulus.size(), 0), m0inv_(0),
+      t_(modulus.size() + 2, 0), table_(16 * modulus.size(), 0)
+{
+    if (n_ == 0 || (m_[0] & 1) == 0)
+    {
+        throw std::invalid_argument("Montgomery modulus must be odd");
+    }
+
+    // Newton iteration for m0^-1 mod 2^bits; each step doubles the
+    // number of correct low bits, starting from 3.
+    Limb inv = m_[0];
+    for (int i = 0; i < 6; ++i)
+    {
+        inv *= Limb(2) - m_[0] * inv;
+    }
+    m0inv_ = Limb(0) - inv;
+
+    // R^2 mod m by doubling 1 a total of 2 * n * bits times.
+    const unsigned bits = limbBits<Limb>();
+    r2_[0] = 1;
+    for (std::size_t i = 0; i < 2 * n_ * bits; ++i)
+    {
+        Limb carry = add(r2_.data(), r2_.data(), r2_.data(), n_);
+        if (carry != 0 || compare(r2_.data(), m_.data(), n_) >= 0)
+        {
+            sub(r2_.data(), r2_.data(), m_.data(), n_);
+        }
+    }
+}
+
+template <typename Limb>
+void Montgomery<Limb>::mul(Limb *r, const Limb *a, const Limb *b)
+{
+    const std::size_t n = n_;
+    const Limb *m = m_.data();
+    Limb *t = t_.data();
+    std::fill(t, t + n + 2, Limb(0));
+
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        // t += a * b[i]
+        Limb carry = 0;
+        const Limb bi = b[i];
+        for (std::size_t j = 0; j < n; ++j)
+        {
+            t[j] = Wide<Limb>::mulAdd(a[j], bi, t[j], carry, carry);
+        }
+        Limb s = t[n] + carry;
+        t[n + 1] = (s < carry) ? 1 : 0;
+        t[n] = s;
+
+        // t = (t + q * m) / 2^bits, choosing q so the low limb vanishes.
+        const Limb q = t[0] * m0inv_;
+        (void)Wide<Limb>::mulAdd(q, m[0], t[0], 0, carry);
+        for (std::size_t j = 1; j < n; ++j)
+        {
+            t[j - 1] = Wide<Limb>::mulAdd(q, m[j], t[j], carry, carry);
+        }
+        s = t[n] + carry;
+        Limb c2 = (s < carry) ? 1 : 0;
+        t[n - 1] = s;
+        t[n] = t[n + 1] + c2;
+    }
+
+    // t < 2m here, so one conditional subtraction finishes the reduction.
+    if (t[n] != 0 || compare(t, m, n) >= 0)
+    {
+        sub(r, t, m, n);
+    }
+    else
+    {
+        std::copy(t, t + n, r);
+    }
+}
+
+template <typename Limb>
+void Montgomery<Limb>::toMontgomery(Limb *r, const Limb *a)
+{
+    mul(r, a, r2_.data());
+}
+
+template <typename Limb>
+void Montgomery<Limb>::fromMontgomery(Limb *r, const Limb *a)
+{
+    std::vector<Limb> one(n_, 0);
+    one[0] = 1;
+    mul(r, a, one.data());
+}
+
+template <typename Limb>
+void Montgomery<Limb>::modExp(Limb *r, const Limb *base, const Limb *exp, std::size_t expLimbs)
+{
+    const std::size_t n = n_;
+    const unsigned bits = limbBits<Limb>();
+    Limb *table = table_.data();
+
+    std::vector<Limb> one(n, 0);
+    one[0] = 1;
+    toMontgomery(table, one.data());
+    toMontgomery(table + n, base);
+    for (std::size_t k = 2; k < 16; ++k)
+    {
+        mul(table + k * n, table + (k - 1) * n, table + n);
+    }
+
+    auto window = [exp, bits](std::size_t pos)
+    {
+        return static_cast<std::size_t>((exp[pos / bits] >> (pos % bits)) & 0xF);
+    };
+
+    // Limb widths are multiples of 4, so windows never straddle limbs.
+    std::size_t pos = expLimbs * bits - 4;
+    std::vector<Limb> acc(table + window(pos) * n, table + (window(pos) + 1) * n);
+    while (pos > 0)
+    {
+        pos -= 4;
+        for (int s = 0; s < 4; ++s)
+        {
+            mul(acc.data(), acc.data(), acc.data());
+        }
+        // Always multiply, even by table[0] == 1, so the operation count
+        // does not depend on the exponent bits.
+        mul(acc.data(), acc.data(), table + window(pos) * n);
+    }
+
+    fromMontgomery(r, acc.data());
+}
+
+#define BIGINT_INSTANTIATE(Limb)                                                         \
+    template Limb add<Limb>(Limb *, const Limb *, const Limb *, std::size_t);          \
+    template Limb sub<Limb>(Limb *, const Limb *, const Limb *, std::size_t);          \
+    template int compare<Limb>(const Limb *, const Limb *, std::size_t);               \
+    template void mulSchoolbook<Limb>(Limb *, const Limb *, const Limb *, std::size_t); \
+    template void mulKaratsuba<Limb>(Limb *, const Limb *, const Limb *, std::size_t, Limb *); \
+    template void modReference<Limb>(Limb *, const Limb *, const Limb *, std::size_t); \
+    template class Montgomery<Limb>;
+
+BIGINT_INSTANTIATE(uint32_t)
+BIGINT_INSTANTIATE(uint64_t)
+
+#undef BIGINT_INSTANTIATE
+
+} // namespace bigint
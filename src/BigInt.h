@@ -0,0 +1,76 @@
+// BigInt.h
+// Fixed-width multiprecision arithmetic for the big-integer benchmark.
+//
+// Numbers are little-endian arrays of limbs. Everything is templated on the
+// limb type and instantiated for 32-bit and 64-bit limbs, so the same code
+// shows how much a target gains from a native 64x64->128 multiply.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bigint {
+
+// Below this many limbs Karatsuba recursion hands over to schoolbook.
+constexpr std::size_t kKaratsubaThreshold = 32;
+
+// r[0, n) = a + b, returns the carry out.
+template <typename Limb>
+Limb add(Limb *r, const Limb *a, const Limb *b, std::size_t n);
+
+// r[0, n) = a - b, returns the borrow out.
+template <typename Limb>
+Limb sub(Limb *r, const Limb *a, const Limb *b, std::size_t n);
+
+// Returns -1, 0 or 1 comparing two n-limb numbers.
+template <typename Limb>
+int compare(const Limb *a, const Limb *b, std::size_t n);
+
+// r[0, 2n) = a * b using the O(n^2) row-by-row method.
+template <typename Limb>
+void mulSchoolbook(Limb *r, const Limb *a, const Limb *b, std::size_t n);
+
+// Number of scratch limbs mulKaratsuba() needs for n-limb operands.
+inline std::size_t karatsubaScratchSize(std::size_t n) { return 4 * n; }
+
+// r[0, 2n) = a * b using subtractive Karatsuba. Falls back to schoolbook
+// below kKaratsubaThreshold or for odd lengths. r must not alias a or b.
+template <typename Limb>
+void mulKaratsuba(Limb *r, const Limb *a, const Limb *b, std::size_t n, Limb *scratch);
+
+// r[0, n) = x mod m for a 2n-limb x, by shift-and-subtract. Slow; only
+// meant as an independent reference for checking the fast paths.
+template <typename Limb>
+void modReference(Limb *r, const Limb *x, const Limb *m, std::size_t n);
+
+// Montgomery arithmetic modulo a fixed odd n-limb modulus. Keeps its own
+// scratch space, so give each thread its own instance.
+template <typename Limb>
+class Montgomery {
+public:
+    explicit Montgomery(const std::vector<Limb> &modulus);
+
+    std::size_t limbs() const { return n_; }
+
+    // r = a * b * R^-1 mod m (CIOS). r may alias a or b.
+    void mul(Limb *r, const Limb *a, const Limb *b);
+
+    void toMontgomery(Limb *r, const Limb *a);
+    void fromMontgomery(Limb *r, const Limb *a);
+
+    // r = base^exp mod m, base and r in normal form. Uses a fixed 4-bit
+    // window; exp has expLimbs limbs.
+    void modExp(Limb *r, const Limb *base, const Limb *exp, std::size_t expLimbs);
+
+private:
+    std::size_t n_;
+    std::vector<Limb> m_;
+    std::vector<Limb> r2_;       // R^2 mod m
+    Limb m0inv_;                 // -m^-1 mod 2^bits
+    std::vector<Limb> t_;        // CIOS accumulator, n + 2 limbs
+    std::vector<Limb> table_;    // window powers, 16 * n limbs
+};
+
+} // namespace bigint
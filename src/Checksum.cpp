@@ -0,0 +1,580 @@
+// Checksum.cpp
+// Table-driven, carry-less multiply and instruction-based CRCs, Adler-32
+// and XXH32/XXH64.
+
+#include "Checksum.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "CpuFeatures.h"
+
+// 32-bit ARM builds get no hardware paths even where AT_HWCAP2 reports
+// CRC32 / PMULL; they run the table versions.
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define CHECKSUM_HW_X86 1
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <arm_neon.h>
+#define CHECKSUM_HW_ARM 1
+#endif
+
+namespace checksum {
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Byte order and rotate helpers. Explicit little-endian loads compile to a
+// single move on little-endian targets.
+
+inline uint32_t load32le(const uint8_t *p)
+{
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+inline uint64_t load64le(const uint8_t *p)
+{
+    return uint64_t(load32le(p)) | (uint64_t(load32le(p + 4)) << 32);
+}
+
+inline uint32_t rotl32(uint32_t x, int r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+// ---------------------------------------------------------------------------
+// Table-driven CRCs (reflected, so the register shifts right). All
+// functions work on the register state: ~0 to start, inverted at the end.
+
+constexpr uint32_t kCrc32Poly = 0xEDB88320u;  // IEEE 802.3 / zlib
+constexpr uint32_t kCrc32cPoly = 0x82F63B78u; // Castagnoli
+
+// t[0] is the classic byte table; t[k][b] is the CRC of byte b followed by
+// k zero bytes, so one lookup per table advances the CRC by k + 1 bytes.
+struct CrcTables {
+    uint32_t t[16][256];
+
+    explicit CrcTables(uint32_t poly)
+    {
+        for (uint32_t b = 0; b < 256; ++b)
+        {
+            uint32_t crc = b;
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                crc = (crc >> 1) ^ (poly & (0u - (crc & 1)));
+            }
+            t[0][b] = crc;
+        }
+        for (int k = 1; k < 16; ++k)
+        {
+            for (uint32_t b = 0; b < 256; ++b)
+            {
+                t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xFF];
+            }
+        }
+    }
+};
+
+const CrcTables &crc32Tables()
+{
+    static const CrcTables tables(kCrc32Poly);
+    return tables;
+}
+
+const CrcTables &crc32cTables()
+{
+    static const CrcTables tables(kCrc32cPoly);
+    return tables;
+}
+
+uint32_t crcBytewise(const CrcTables &tables, uint32_t crc, const uint8_t *p, std::size_t len)
+{
+    for (std::size_t i = 0; i < len; ++i)
+    {
+        crc = tables.t[0][(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+// Eight independent lookups per step instead of a chain of eight.
+uint32_t crcSlice8(const CrcTables &tables, uint32_t crc, const uint8_t *p, std::size_t len)
+{
+    const auto &t = tables.t;
+    for (; len >= 8; p += 8, len -= 8)
+    {
+        const uint32_t lo = load32le(p) ^ crc;
+        const uint32_t hi = load32le(p + 4);
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+    }
+    return crcBytewise(tables, crc, p, len);
+}
+
+uint32_t crcSlice16(const CrcTables &tables, uint32_t crc, const uint8_t *p, std::size_t len)
+{
+    const auto &t = tables.t;
+    for (; len >= 16; p += 16, len -= 16)
+    {
+        const uint32_t w0 = load32le(p) ^ crc;
+        const uint32_t w1 = load32le(p + 4);
+        const uint32_t w2 = load32le(p + 8);
+        const uint32_t w3 = load32le(p + 12);
+        crc = t[15][w0 & 0xFF] ^ t[14][(w0 >> 8) & 0xFF] ^ t[13][(w0 >> 16) & 0xFF] ^ t[12][w0 >> 24] ^
+              t[11][w1 & 0xFF] ^ t[10][(w1 >> 8) & 0xFF] ^ t[9][(w1 >> 16) & 0xFF] ^ t[8][w1 >> 24] ^
+              t[7][w2 & 0xFF] ^ t[6][(w2 >> 8) & 0xFF] ^ t[5][(w2 >> 16) & 0xFF] ^ t[4][w2 >> 24] ^
+              t[3][w3 & 0xFF] ^ t[2][(w3 >> 8) & 0xFF] ^ t[1][(w3 >> 16) & 0xFF] ^ t[0][w3 >> 24];
+    }
+    return crcBytewise(tables, crc, p, len);
+}
+
+// ---------------------------------------------------------------------------
+// Carry-less multiply folding (Gopal et al., "Fast CRC Computation for
+// Generic Polynomials Using PCLMULQDQ"). Four 128-bit accumulators fold
+// 64 bytes ahead per step (x^512 / x^576 mod P), then collapse into one
+// (x^128 / x^192 mod P) that folds in any remaining 16-byte blocks. The
+// constants are the bit-reflected ones from the paper, shifted left by
+// one. The final 128 bits are reduced with the tables, which is one
+// slice-by-16 step; the paper's Barrett reduction saves little on top.
+
+constexpr uint64_t kFold512Lo = 0x154442bd4; // k1
+constexpr uint64_t kFold512Hi = 0x1c6e41596; // k2
+constexpr uint64_t kFold128Lo = 0x1751997d0; // k3
+constexpr uint64_t kFold128Hi = 0x0ccaa009e; // k4
+
+// Smallest input worth folding; shorter ones go through the tables.
+constexpr std::size_t kFoldMinimum = 64;
+
+#if defined(CHECKSUM_HW_X86)
+
+#define CHECKSUM_FOLD_TARGET __attribute__((target("pclmul,sse2")))
+
+CHECKSUM_FOLD_TARGET
+inline __m128i fold(__m128i x, __m128i k, __m128i data)
+{
+    return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11)), data);
+}
+
+CHECKSUM_FOLD_TARGET
+inline __m128i load128(const uint8_t *p)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+// len is a multiple of 16 and at least kFoldMinimum.
+CHECKSUM_FOLD_TARGET
+uint32_t crc32Fold(uint32_t crc, const uint8_t *p, std::size_t len)
+{
+    const __m128i k512 = _mm_set_epi64x(static_cast<long long>(kFold512Hi), static_cast<long long>(kFold512Lo));
+    const __m128i k128 = _mm_set_epi64x(static_cast<long long>(kFold128Hi), static_cast<long long>(kFold128Lo));
+
+    __m128i x0 = _mm_xor_si128(load128(p), _mm_cvtsi32_si128(static_cast<int>(crc)));
+    __m128i x1 = load128(p + 16);
+    __m128i x2 = load128(p + 32);
+    __m128i x3 = load128(p + 48);
+    p += 64;
+    len -= 64;
+
+    for (; len >= 64; p += 64, len -= 64)
+    {
+        x0 = fold(x0, k512, load128(p));
+        x1 = fold(x1, k512, load128(p + 16));
+        x2 = fold(x2, k512, load128(p + 32));
+        x3 = fold(x3, k512, load128(p + 48));
+    }
+
+    x0 = fold(x0, k128, x1);
+    x0 = fold(x0, k128, x2);
+    x0 = fold(x0, k128, x3);
+    for (; len >= 16; p += 16, len -= 16)
+    {
+        x0 = fold(x0, k128, load128(p));
+    }
+
+    uint8_t rest[16];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(rest), x0);
+    return crcSlice16(crc32Tables(), 0, rest, sizeof(rest));
+}
+
+#undef CHECKSUM_FOLD_TARGET
+
+__attribute__((target("sse4.2")))
+uint32_t crc32cInstruction(uint32_t crc, const uint8_t *p, std::size_t len)
+{
+    uint64_t state = crc;
+    for (; len >= 8; p += 8, len -= 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        state = _mm_crc32_u64(state, word);
+    }
+    crc = static_cast<uint32_t>(state);
+    for (; len > 0; ++p, --len)
+    {
+        crc = _mm_crc32_u8(crc, *p);
+    }
+    return crc;
+}
+
+#elif defined(CHECKSUM_HW_ARM)
+
+#define CHECKSUM_FOLD_TARGET __attribute__((target("+crypto")))
+
+CHECKSUM_FOLD_TARGET
+inline uint64x2_t fold(uint64x2_t x, uint64x2_t k, uint64x2_t data)
+{
+    const uint64x2_t lo = vreinterpretq_u64_p128(
+        vmull_p64(static_cast<poly64_t>(vgetq_lane_u64(x, 0)), static_cast<poly64_t>(vgetq_lane_u64(k, 0))));
+    const uint64x2_t hi = vreinterpretq_u64_p128(
+        vmull_p64(static_cast<poly64_t>(vgetq_lane_u64(x, 1)), static_cast<poly64_t>(vgetq_lane_u64(k, 1))));
+    return veorq_u64(veorq_u64(lo, hi), data);
+}
+
+CHECKSUM_FOLD_TARGET
+inline uint64x2_t load128(const uint8_t *p)
+{
+    return vreinterpretq_u64_u8(vld1q_u8(p));
+}
+
+CHECKSUM_FOLD_TARGET
+uint32_t crc32Fold(uint32_t crc, const uint8_t *p, std::size_t len)
+{
+    const uint64x2_t k512 = vcombine_u64(vcreate_u64(kFold512Lo), vcreate_u64(kFold512Hi));
+    const uint64x2_t k128 = vcombine_u64(vcreate_u64(kFold128Lo), vcreate_u64(kFold128Hi));
+
+    uint64x2_t x0 = veorq_u64(load128(p), vcombine_u64(vcreate_u64(crc), vcreate_u64(0)));
+    uint64x2_t x1 = load128(p + 16);
+    uint64x2_t x2 = load128(p + 32);
+    uint64x2_t x3 = load128(p + 48);
+    p += 64;
+    len -= 64;
+
+    for (; len >= 64; p += 64, len -= 64)
+    {
+        x0 = fold(x0, k512, load128(p));
+        x1 = fold(x1, k512, load128(p + 16));
+        x2 = fold(x2, k512, load128(p + 32));
+        x3 = fold(x3, k512, load128(p + 48));
+    }
+
+    x0 = fold(x0, k128, x1);
+    x0 = fold(x0, k128, x2);
+    x0 = fold(x0, k128, x3);
+    for (; len >= 16; p += 16, len -= 16)
+    {
+        x0 = fold(x0, k128, load128(p));
+    }
+
+    uint8_t rest[16];
+    vst1q_u8(rest, vreinterpretq_u8_u64(x0));
+    return crcSlice16(crc32Tables(), 0, rest, sizeof(rest));
+}
+
+#undef CHECKSUM_FOLD_TARGET
+
+__attribute__((target("+crc")))
+uint32_t crc32Instruction(uint32_t crc, const uint8_t *p, std::size_t len)
+{
+    for (; len >= 8; p += 8, len -= 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        crc = __crc32d(crc, word);
+    }
+    for (; len > 0; ++p, --len)
+    {
+        crc = __crc32b(crc, *p);
+    }
+    return crc;
+}
+
+__attribute__((target("+crc")))
+uint32_t crc32cInstruction(uint32_t crc, const uint8_t *p, std::size_t len)
+{
+    for (; len >= 8; p += 8, len -= 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        crc = __crc32cd(crc, word);
+    }
+    for (; len > 0; ++p, --len)
+    {
+        crc = __crc32cb(crc, *p);
+    }
+    return crc;
+}
+
+#endif
+
+// ---------------------------------------------------------------------------
+// Adler-32 (RFC 1950). The sums are reduced only every kAdlerBlock bytes,
+// the most that cannot overflow 32 bits.
+
+constexpr uint32_t kAdlerModulus = 65521;
+constexpr std::size_t kAdlerBlock = 5552;
+
+uint32_t adler32(const uint8_t *p, std::size_t len)
+{
+    uint32_t a = 1;
+    uint32_t b = 0;
+    while (len > 0)
+    {
+        const std::size_t n = len < kAdlerBlock ? len : kAdlerBlock;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            a += p[i];
+            b += a;
+        }
+        a %= kAdlerModulus;
+        b %= kAdlerModulus;
+        p += n;
+        len -= n;
+    }
+    return (b << 16) | a;
+}
+
+// ---------------------------------------------------------------------------
+// xxHash (XXH32 / XXH64, seed 0): four independent lanes over 16- or
+// 32-byte stripes, then the tail and a final avalanche.
+
+constexpr uint32_t kPrime32[5] = {0x9E3779B1u, 0x85EBCA77u, 0xC2B2AE3Du, 0x27D4EB2Fu, 0x165667B1u};
+constexpr uint64_t kPrime64[5] = {0x9E3779B185EBCA87ull, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull,
+                                  0x85EBCA77C2B2AE63ull, 0x27D4EB2F165667C5ull};
+
+inline uint32_t xxh32Round(uint32_t acc, uint32_t input)
+{
+    return rotl32(acc + input * kPrime32[1], 13) * kPrime32[0];
+}
+
+uint32_t xxh32(const uint8_t *p, std::size_t len)
+{
+    const uint8_t *const end = p + len;
+    uint32_t h;
+    if (len >= 16)
+    {
+        uint32_t v1 = kPrime32[0] + kPrime32[1];
+        uint32_t v2 = kPrime32[1];
+        uint32_t v3 = 0;
+        uint32_t v4 = 0u - kPrime32[0];
+        for (; end - p >= 16; p += 16)
+        {
+            v1 = xxh32Round(v1, load32le(p));
+            v2 = xxh32Round(v2, load32le(p + 4));
+            v3 = xxh32Round(v3, load32le(p + 8));
+            v4 = xxh32Round(v4, load32le(p + 12));
+        }
+        h = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+    }
+    else
+    {
+        h = kPrime32[4];
+    }
+    h += static_cast<uint32_t>(len);
+
+    for (; end - p >= 4; p += 4)
+    {
+        h = rotl32(h + load32le(p) * kPrime32[2], 17) * kPrime32[3];
+    }
+    for (; p < end; ++p)
+    {
+        h = rotl32(h + *p * kPrime32[4], 11) * kPrime32[0];
+    }
+
+    h ^= h >> 15;
+    h *= kPrime32[1];
+    h ^= h >> 13;
+    h *= kPrime32[2];
+    h ^= h >> 16;
+    return h;
+}
+
+inline uint64_t xxh64Round(uint64_t acc, uint64_t input)
+{
+    return rotl64(acc + input * kPrime64[1], 31) * kPrime64[0];
+}
+
+inline uint64_t xxh64Merge(uint64_t h, uint64_t lane)
+{
+    return (h ^ xxh64Round(0, lane)) * kPrime64[0] + kPrime64[3];
+}
+
+uint64_t xxh64(const uint8_t *p, std::size_t len)
+{
+    const uint8_t *const end = p + len;
+    uint64_t h;
+    if (len >= 32)
+    {
+        uint64_t v1 = kPrime64[0] + kPrime64[1];
+        uint64_t v2 = kPrime64[1];
+        uint64_t v3 = 0;
+        uint64_t v4 = 0ull - kPrime64[0];
+        for (; end - p >= 32; p += 32)
+        {
+            v1 = xxh64Round(v1, load64le(p));
+            v2 = xxh64Round(v2, load64le(p + 8));
+            v3 = xxh64Round(v3, load64le(p + 16));
+            v4 = xxh64Round(v4, load64le(p + 24));
+        }
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxh64Merge(h, v1);
+        h = xxh64Merge(h, v2);
+        h = xxh64Merge(h, v3);
+        h = xxh64Merge(h, v4);
+    }
+    else
+    {
+        h = kPrime64[4];
+    }
+    h += static_cast<uint64_t>(len);
+
+    for (; end - p >= 8; p += 8)
+    {
+        h = rotl64(h ^ xxh64Round(0, load64le(p)), 27) * kPrime64[0] + kPrime64[3];
+    }
+    if (end - p >= 4)
+    {
+        h = rotl64(h ^ (uint64_t(load32le(p)) * kPrime64[0]), 23) * kPrime64[1] + kPrime64[2];
+        p += 4;
+    }
+    for (; p < end; ++p)
+    {
+        h = rotl64(h ^ (*p * kPrime64[4]), 11) * kPrime64[0];
+    }
+
+    h ^= h >> 33;
+    h *= kPrime64[1];
+    h ^= h >> 29;
+    h *= kPrime64[2];
+    h ^= h >> 32;
+    return h;
+}
+
+} // namespace
+
+const char *algorithmName(Algorithm algorithm)
+{
+    switch (algorithm)
+    {
+    case Algorithm::Crc32Bytewise:
+        return "CRC32 bytewise";
+    case Algorithm::Crc32Slice8:
+        return "CRC32 slice-8";
+    case Algorithm::Crc32Slice16:
+        return "CRC32 slice-16";
+    case Algorithm::Crc32Fold:
+#if defined(CHECKSUM_HW_X86)
+        return "CRC32 PCLMUL";
+#elif defined(CHECKSUM_HW_ARM)
+        return "CRC32 PMULL";
+#else
+        return "CRC32 fold";
+#endif
+    case Algorithm::Crc32Instruction:
+        return "CRC32 ARMv8";
+    case Algorithm::Crc32cSlice8:
+        return "CRC32C slice-8";
+    case Algorithm::Crc32cInstruction:
+#if defined(CHECKSUM_HW_X86)
+        return "CRC32C SSE4.2";
+#elif defined(CHECKSUM_HW_ARM)
+        return "CRC32C ARMv8";
+#else
+        return "CRC32C instruction";
+#endif
+    case Algorithm::Adler32:
+        return "Adler-32";
+    case Algorithm::Xxh32:
+        return "XXH32";
+    case Algorithm::Xxh64:
+        return "XXH64";
+    }
+    return "unknown";
+}
+
+bool available(Algorithm algorithm)
+{
+    const cpu::Features &features = cpu::features();
+    switch (algorithm)
+    {
+    case Algorithm::Crc32Fold:
+#if defined(CHECKSUM_HW_X86) || defined(CHECKSUM_HW_ARM)
+        return features.clmul;
+#else
+        return false;
+#endif
+    case Algorithm::Crc32Instruction:
+#if defined(CHECKSUM_HW_ARM)
+        return features.crc32;
+#else
+        return false;
+#endif
+    case Algorithm::Crc32cInstruction:
+#if defined(CHECKSUM_HW_X86)
+        return features.sse42;
+#elif defined(CHECKSUM_HW_ARM)
+        return features.crc32;
+#else
+        return false;
+#endif
+    default:
+        (void)features;
+        return true;
+    }
+}
+
+uint64_t compute(Algorithm algorithm, const uint8_t *data, std::size_t len)
+{
+    if (!available(algorithm))
+    {
+        throw std::runtime_error(std::string(algorithmName(algorithm)) + " not supported on this CPU");
+    }
+
+    switch (algorithm)
+    {
+    case Algorithm::Crc32Bytewise:
+        return ~crcBytewise(crc32Tables(), ~0u, data, len);
+    case Algorithm::Crc32Slice8:
+        return ~crcSlice8(crc32Tables(), ~0u, data, len);
+    case Algorithm::Crc32Slice16:
+        return ~crcSlice16(crc32Tables(), ~0u, data, len);
+    case Algorithm::Crc32cSlice8:
+        return ~crcSlice8(crc32cTables(), ~0u, data, len);
+#if defined(CHECKSUM_HW_X86) || defined(CHECKSUM_HW_ARM)
+    case Algorithm::Crc32Fold:
+    {
+        uint32_t crc = ~0u;
+        if (len >= kFoldMinimum)
+        {
+            const std::size_t folded = len & ~std::size_t(15);
+            crc = crc32Fold(crc, data, folded);
+            data += folded;
+            len -= folded;
+        }
+        return ~crcSlice16(crc32Tables(), crc, data, len);
+    }
+    case Algorithm::Crc32cInstruction:
+        return ~crc32cInstruction(~0u, data, len);
+#endif
+#if defined(CHECKSUM_HW_ARM)
+    case Algorithm::Crc32Instruction:
+        return ~crc32Instruction(~0u, data, len);
+#endif
+    case Algorithm::Adler32:
+        return adler32(data, len);
+    case Algorithm::Xxh32:
+        return xxh32(data, len);
+    case Algorithm::Xxh64:
+        return xxh64(data, len);
+    default:
+        break;
+    }
+    return 0;
+}
+
+} // namespace checksum
@@ -0,0 +1,37 @@
+// Checksum.h
+// CRC-32 / CRC-32C with table, folding and instruction paths, Adler-32
+// and xxHash, used by the checksum benchmark.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace checksum {
+
+enum class Algorithm {
+    Crc32Bytewise,     // One 256-entry table lookup per byte
+    Crc32Slice8,       // Eight tables, 8 bytes per step
+    Crc32Slice16,      // Sixteen tables, 16 bytes per step
+    Crc32Fold,         // Carry-less multiply folding (PCLMULQDQ / PMULL)
+    Crc32Instruction,  // ARMv8 CRC32X
+    Crc32cSlice8,      // CRC-32C (Castagnoli) with eight tables
+    Crc32cInstruction, // SSE4.2 CRC32 / ARMv8 CRC32CX
+    Adler32,
+    Xxh32,
+    Xxh64
+};
+
+// Name for reports: "CRC32 slice-8", "CRC32 PCLMUL", "CRC32C SSE4.2",
+// "Adler-32", "XXH64", ...
+const char *algorithmName(Algorithm algorithm);
+
+// Whether this build and the CPU it runs on support the algorithm.
+bool available(Algorithm algorithm);
+
+// Checksum of len bytes: the zlib CRC-32 for every Crc32 variant, the
+// iSCSI/ext4 CRC-32C, Adler-32 as in zlib, and XXH32/XXH64 with seed 0.
+// 32-bit results are zero-extended.
+uint64_t compute(Algorithm algorithm, const uint8_t *data, std::size_t len);
+
+} // namespace checksum
@@ -0,0 +1,487 @@
+// Complex.cpp
+// Complex kernels in each layout, scalar and SIMD.
+
+#include "Complex.h"
+
+#include <cmath>
+#include <random>
+
+#include "CpuFeatures.h"
+#include "Simd.h"
+
+namespace cplx {
+
+namespace {
+
+using simd::Vec4;
+using simd::Vec4i;
+
+// Four-quadrant arctangent: an 11th-order odd minimax polynomial on
+// [0, 1] plus octant fix-ups, all branch-free so every lane takes the
+// same path.
+template <typename V>
+SIMD_INLINE V atan2v(V y, V x)
+{
+    const V zero = {};
+    const V one = zero + 1.0f;
+    const V ax = x < zero ? -x : x;
+    const V ay = y < zero ? -y : y;
+    const V hi = ax > ay ? ax : ay;
+    const V lo = ax > ay ? ay : ax;
+    const V t = lo / (hi == zero ? one : hi);
+    const V s = t * t;
+    V r = t * (0.99997726f +
+               s * (-0.33262347f + s * (0.19354346f + s * (-0.11643287f + s * (0.05265332f + s * -0.01172120f)))));
+    r = ay > ax ? 1.57079637f - r : r;
+    r = x < zero ? 3.14159274f - r : r;
+    return y < zero ? -r : r;
+}
+
+template <typename V>
+SIMD_INLINE float horizontalSum(V v)
+{
+    float sum = 0.0f;
+    for (std::size_t k = 0; k < simd::lanes<V>(); ++k)
+    {
+        sum += v[k];
+    }
+    return sum;
+}
+
+// Split-array kernels, one vector of complex numbers at a time. Compiled
+// once per SIMD level below.
+template <typename V>
+SIMD_INLINE void macSplit(const float *ar, const float *ai, const float *br, const float *bi, float *accr,
+                          float *acci, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; i += simd::lanes<V>())
+    {
+        const V xr = simd::load<V>(ar + i), xi = simd::load<V>(ai + i);
+        const V yr = simd::load<V>(br + i), yi = simd::load<V>(bi + i);
+        simd::store(accr + i, simd::load<V>(accr + i) + xr * yr - xi * yi);
+        simd::store(acci + i, simd::load<V>(acci + i) + xr * yi + xi * yr);
+    }
+}
+
+template <typename V>
+SIMD_INLINE std::complex<float> dotSplit(const float *ar, const float *ai, const float *br, const float *bi,
+                                         std::size_t n)
+{
+    V re = {}, im = {};
+    for (std::size_t i = 0; i < n; i += simd::lanes<V>())
+    {
+        const V xr = simd::load<V>(ar + i), xi = simd::load<V>(ai + i);
+        const V yr = simd::load<V>(br + i), yi = simd::load<V>(bi + i);
+        re += xr * yr + xi * yi;
+        im += xr * yi - xi * yr;
+    }
+    return {horizontalSum(re), horizontalSum(im)};
+}
+
+template <typename V>
+SIMD_INLINE void magnitudePhaseSplit(const float *ar, const float *ai, float *magnitude, float *phase, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; i += simd::lanes<V>())
+    {
+        const V re = simd::load<V>(ar + i), im = simd::load<V>(ai + i);
+        simd::store(magnitude + i, simd::sqrt(re * re + im * im));
+        simd::store(phase + i, atan2v(im, re));
+    }
+}
+
+// Entry points for one SIMD level.
+struct SplitKernels
+{
+    void (*mac)(const float *, const float *, const float *, const float *, float *, float *, std::size_t);
+    std::complex<float> (*dot)(const float *, const float *, const float *, const float *, std::size_t);
+    void (*magnitudePhase)(const float *, const float *, float *, float *, std::size_t);
+};
+
+void macBaseline(const float *ar, const float *ai, const float *br, const float *bi, float *accr, float *acci,
+                 std::size_t n)
+{
+    macSplit<Vec4>(ar, ai, br, bi, accr, acci, n);
+}
+
+std::complex<float> dotBaseline(const float *ar, const float *ai, const float *br, const float *bi, std::size_t n)
+{
+    return dotSplit<Vec4>(ar, ai, br, bi, n);
+}
+
+void magnitudePhaseBaseline(const float *ar, const float *ai, float *magnitude, float *phase, std::size_t n)
+{
+    magnitudePhaseSplit<Vec4>(ar, ai, magnitude, phase, n);
+}
+
+#if defined(SIMD_AVX2_VARIANT)
+SIMD_AVX2_TARGET
+void macAvx2(const float *ar, const float *ai, const float *br, const float *bi, float *accr, float *acci,
+             std::size_t n)
+{
+    macSplit<simd::Vec8>(ar, ai, br, bi, accr, acci, n);
+}
+
+SIMD_AVX2_TARGET
+std::complex<float> dotAvx2(const float *ar, const float *ai, const float *br, const float *bi, std::size_t n)
+{
+    return dotSplit<simd::Vec8>(ar, ai, br, bi, n);
+}
+
+SIMD_AVX2_TARGET
+void magnitudePhaseAvx2(const float *ar, const float *ai, float *magnitude, float *phase, std::size_t n)
+{
+    magnitudePhaseSplit<simd::Vec8>(ar, ai, magnitude, phase, n);
+}
+#elif defined(SIMD_NEON_VARIANT)
+SIMD_NEON_TARGET
+void macNeon(const float *ar, const float *ai, const float *br, const float *bi, float *accr, float *acci,
+             std::size_t n)
+{
+    macSplit<Vec4>(ar, ai, br, bi, accr, acci, n);
+}
+
+SIMD_NEON_TARGET
+std::complex<float> dotNeon(const float *ar, const float *ai, const float *br, const float *bi, std::size_t n)
+{
+    return dotSplit<Vec4>(ar, ai, br, bi, n);
+}
+
+SIMD_NEON_TARGET
+void magnitudePhaseNeon(const float *ar, const float *ai, float *magnitude, float *phase, std::size_t n)
+{
+    magnitudePhaseSplit<Vec4>(ar, ai, magnitude, phase, n);
+}
+#endif
+
+const SplitKernels &splitKernels()
+{
+    static const SplitKernels kernels = []() -> SplitKernels
+    {
+        switch (cpu::simdLevel())
+        {
+#if defined(SIMD_AVX2_VARIANT)
+        case cpu::SimdLevel::Avx2:
+            return {macAvx2, dotAvx2, magnitudePhaseAvx2};
+#elif defined(SIMD_NEON_VARIANT)
+        case cpu::SimdLevel::Neon:
+            return {macNeon, dotNeon, magnitudePhaseNeon};
+#endif
+        default:
+            return {macBaseline, dotBaseline, magnitudePhaseBaseline};
+        }
+    }();
+    return kernels;
+}
+
+// Two interleaved complex numbers per vector: (re0, im0, re1, im1).
+const Vec4i kRealLanes = {0, 0, 2, 2};
+const Vec4i kImagLanes = {1, 1, 3, 3};
+const Vec4i kSwapLanes = {1, 0, 3, 2};
+
+// a * b: re = ar br - ai bi, im = ar bi + ai br
+inline Vec4 mulInterleaved(Vec4 a, Vec4 b)
+{
+    const Vec4 sign = {-1.0f, 1.0f, -1.0f, 1.0f};
+    return __builtin_shuffle(a, kRealLanes) * b +
+           sign * (__builtin_shuffle(a, kImagLanes) * __builtin_shuffle(b, kSwapLanes));
+}
+
+// conj(a) * b: re = ar br + ai bi, im = ar bi - ai br
+inline Vec4 conjMulInterleaved(Vec4 a, Vec4 b)
+{
+    const Vec4 sign = {1.0f, -1.0f, 1.0f, -1.0f};
+    return __builtin_shuffle(a, kRealLanes) * b +
+           sign * (__builtin_shuffle(a, kImagLanes) * __builtin_shuffle(b, kSwapLanes));
+}
+
+} // namespace
+
+std::string variantName(Variant variant)
+{
+    switch (variant)
+    {
+    case Variant::StdComplex:
+        return "std::complex";
+    case Variant::Interleaved:
+        return "interleaved";
+    case Variant::InterleavedVector:
+        // Two complex numbers per 4-wide vector; the shuffles do not widen.
+        return std::string("interleaved ") + cpu::simdLevelName(cpu::SimdLevel::Baseline);
+    case Variant::Split:
+        return "split";
+    case Variant::SplitVector:
+        return std::string("split ") + cpu::simdLevelName(cpu::simdLevel());
+    }
+    return "unknown";
+}
+
+Buffers::Buffers(Variant variant, std::size_t n, uint32_t seed)
+    : variant_(variant), n_((n + simd::kMaxWidth - 1) / simd::kMaxWidth * simd::kMaxWidth)
+{
+    std::mt19937 engine(seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<std::complex<float>> a(n_), b(n_);
+    for (std::size_t i = 0; i < n_; ++i)
+    {
+        a[i] = {unit(engine), unit(engine)};
+        b[i] = {unit(engine), unit(engine)};
+    }
+
+    switch (variant_)
+    {
+    case Variant::StdComplex:
+        ca_ = a;
+        cb_ = b;
+        break;
+    case Variant::Interleaved:
+    case Variant::InterleavedVector:
+        ia_.resize(2 * n_);
+        ib_.resize(2 * n_);
+        for (std::size_t i = 0; i < n_; ++i)
+        {
+            ia_[2 * i] = a[i].real();
+            ia_[2 * i + 1] = a[i].imag();
+            ib_[2 * i] = b[i].real();
+            ib_[2 * i + 1] = b[i].imag();
+        }
+        break;
+    case Variant::Split:
+    case Variant::SplitVector:
+        ar_.resize(n_);
+        ai_.resize(n_);
+        br_.resize(n_);
+        bi_.resize(n_);
+        for (std::size_t i = 0; i < n_; ++i)
+        {
+            ar_[i] = a[i].real();
+            ai_[i] = a[i].imag();
+            br_[i] = b[i].real();
+            bi_[i] = b[i].imag();
+        }
+        break;
+    }
+    magnitude_.resize(n_);
+    phase_.resize(n_);
+    clearAccumulator();
+}
+
+void Buffers::clearAccumulator()
+{
+    switch (variant_)
+    {
+    case Variant::StdComplex:
+        cacc_.assign(n_, std::complex<float>());
+        break;
+    case Variant::Interleaved:
+    case Variant::InterleavedVector:
+        iacc_.assign(2 * n_, 0.0f);
+        break;
+    case Variant::Split:
+    case Variant::SplitVector:
+        accr_.assign(n_, 0.0f);
+        acci_.assign(n_, 0.0f);
+        break;
+    }
+}
+
+std::complex<float> Buffers::a(std::size_t i) const
+{
+    switch (variant_)
+    {
+    case Variant::StdComplex:
+        return ca_[i];
+    case Variant::Interleaved:
+    case Variant::InterleavedVector:
+        return {ia_[2 * i], ia_[2 * i + 1]};
+    default:
+        return {ar_[i], ai_[i]};
+    }
+}
+
+std::complex<float> Buffers::b(std::size_t i) const
+{
+    switch (variant_)
+    {
+    case Variant::StdComplex:
+        return cb_[i];
+    case Variant::Interleaved:
+    case Variant::InterleavedVector:
+        return {ib_[2 * i], ib_[2 * i + 1]};
+    default:
+        return {br_[i], bi_[i]};
+    }
+}
+
+std::complex<float> Buffers::accumulator(std::size_t i) const
+{
+    switch (variant_)
+    {
+    case Variant::StdComplex:
+        return cacc_[i];
+    case Variant::Interleaved:
+    case Variant::InterleavedVector:
+        return {iacc_[2 * i], iacc_[2 * i + 1]};
+    default:
+        return {accr_[i], acci_[i]};
+    }
+}
+
+// std::complex multiplication follows C99 Annex G: a NaN result has to be
+// checked for and recomputed (__mulsc3) in case an input was infinite.
+// The hand-written forms skip that, as -fcx-limited-range would.
+void Buffers::multiplyAccumulate()
+{
+    switch (variant_)
+    {
+    case Variant::StdComplex:
+        for (std::size_t i = 0; i < n_; ++i)
+        {
+            cacc_[i] += ca_[i] * cb_[i];
+        }
+        break;
+    case Variant::Interleaved:
+    {
+        const float *a = ia_.data(), *b = ib_.data();
+        float *acc = iacc_.data();
+        for (std::size_t i = 0; i < 2 * n_; i += 2)
+        {
+            acc[i] += a[i] * b[i] - a[i + 1] * b[i + 1];
+            acc[i + 1] += a[i] * b[i + 1] + a[i + 1] * b[i];
+        }
+        break;
+    }
+    case Variant::InterleavedVector:
+    {
+        const float *a = ia_.data(), *b = ib_.data();
+        float *acc = iacc_.data();
+        for (std::size_t i = 0; i < 2 * n_; i += simd::kWidth)
+        {
+            simd::store(acc + i, simd::load<Vec4>(acc + i) +
+                                     mulInterleaved(simd::load<Vec4>(a + i), simd::load<Vec4>(b + i)));
+        }
+        break;
+    }
+    case Variant::Split:
+    {
+        const float *ar = ar_.data(), *ai = ai_.data(), *br = br_.data(), *bi = bi_.data();
+        float *accr = accr_.data(), *acci = acci_.data();
+        for (std::size_t i = 0; i < n_; ++i)
+        {
+            accr[i] += ar[i] * br[i] - ai[i] * bi[i];
+            acci[i] += ar[i] * bi[i] + ai[i] * br[i];
+        }
+        break;
+    }
+    case Variant::SplitVector:
+        splitKernels().mac(ar_.data(), ai_.data(), br_.data(), bi_.data(), accr_.data(), acci_.data(), n_);
+        break;
+    }
+}
+
+std::complex<float> Buffers::dot() const
+{
+    switch (variant_)
+    {
+    case Variant::StdComplex:
+    {
+        std::complex<float> sum;
+        for (std::size_t i = 0; i < n_; ++i)
+        {
+            sum += std::conj(ca_[i]) * cb_[i];
+        }
+        return sum;
+    }
+    case Variant::Interleaved:
+    {
+        const float *a = ia_.data(), *b = ib_.data();
+        float re = 0.0f, im = 0.0f;
+        for (std::size_t i = 0; i < 2 * n_; i += 2)
+        {
+            re += a[i] * b[i] + a[i + 1] * b[i + 1];
+            im += a[i] * b[i + 1] - a[i + 1] * b[i];
+        }
+        return {re, im};
+    }
+    case Variant::InterleavedVector:
+    {
+        const float *a = ia_.data(), *b = ib_.data();
+        Vec4 sum = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (std::size_t i = 0; i < 2 * n_; i += simd::kWidth)
+        {
+            sum += conjMulInterleaved(simd::load<Vec4>(a + i), simd::load<Vec4>(b + i));
+        }
+        return {sum[0] + sum[2], sum[1] + sum[3]};
+    }
+    case Variant::Split:
+    {
+        const float *ar = ar_.data(), *ai = ai_.data(), *br = br_.data(), *bi = bi_.data();
+        float re = 0.0f, im = 0.0f;
+        for (std::size_t i = 0; i < n_; ++i)
+        {
+            re += ar[i] * br[i] + ai[i] * bi[i];
+            im += ar[i] * bi[i] - ai[i] * br[i];
+        }
+        return {re, im};
+    }
+    case Variant::SplitVector:
+        return splitKernels().dot(ar_.data(), ai_.data(), br_.data(), bi_.data(), n_);
+    }
+    return {};
+}
+
+// std::abs is hypot(), which rescales to avoid overflow; the hand-written
+// forms use sqrt(re^2 + im^2) directly.
+void Buffers::magnitudePhase()
+{
+    float *magnitude = magnitude_.data(), *phase = phase_.data();
+    switch (variant_)
+    {
+    case Variant::StdComplex:
+        for (std::size_t i = 0; i < n_; ++i)
+        {
+            magnitude[i] = std::abs(ca_[i]);
+            phase[i] = std::arg(ca_[i]);
+        }
+        break;
+    case Variant::Interleaved:
+    {
+        const float *a = ia_.data();
+        for (std::size_t i = 0; i < n_; ++i)
+        {
+            const float re = a[2 * i], im = a[2 * i + 1];
+            magnitude[i] = std::sqrt(re * re + im * im);
+            phase[i] = std::atan2(im, re);
+        }
+        break;
+    }
+    case Variant::InterleavedVector:
+    {
+        // Deinterleave two vectors into four real and four imaginary parts.
+        const Vec4i evens = {0, 2, 4, 6}, odds = {1, 3, 5, 7};
+        const float *a = ia_.data();
+        for (std::size_t i = 0; i < n_; i += simd::kWidth)
+        {
+            const Vec4 lo = simd::load<Vec4>(a + 2 * i), hi = simd::load<Vec4>(a + 2 * i + simd::kWidth);
+            const Vec4 re = __builtin_shuffle(lo, hi, evens), im = __builtin_shuffle(lo, hi, odds);
+            simd::store(magnitude + i, simd::sqrt(re * re + im * im));
+            simd::store(phase + i, atan2v(im, re));
+        }
+        break;
+    }
+    case Variant::Split:
+    {
+        const float *ar = ar_.data(), *ai = ai_.data();
+        for (std::size_t i = 0; i < n_; ++i)
+        {
+            magnitude[i] = std::sqrt(ar[i] * ar[i] + ai[i] * ai[i]);
+            phase[i] = std::atan2(ai[i], ar[i]);
+        }
+        break;
+    }
+    case Variant::SplitVector:
+        splitKernels().magnitudePhase(ar_.data(), ai_.data(), magnitude, phase, n_);
+        break;
+    }
+}
+
+} // namespace cplx
@@ -0,0 +1,64 @@
+// Complex.h
+// Complex multiply-accumulate, dot product and magnitude/phase kernels over
+// std::complex, interleaved and split real/imaginary arrays, used by the
+// complex-number benchmark.
+
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cplx {
+
+enum class Variant {
+    StdComplex,        // std::vector<std::complex<float>>, library operators
+    Interleaved,       // re, im, re, im... with the textbook formulas
+    InterleavedVector, // Same layout, two complex numbers per vector
+    Split,             // Separate re[] and im[] arrays, scalar
+    SplitVector        // Separate arrays, one vector of complex numbers at a time
+};
+
+// Vector variants include the SIMD level they run at, e.g. "split AVX2".
+std::string variantName(Variant variant);
+
+class Buffers {
+public:
+    // Two operand arrays a and b of n random values in the unit square;
+    // n is rounded up to a multiple of simd::kMaxWidth.
+    Buffers(Variant variant, std::size_t n, uint32_t seed);
+
+    std::size_t size() const { return n_; }
+
+    // acc[i] += a[i] * b[i]
+    void multiplyAccumulate();
+    // sum of conj(a[i]) * b[i]
+    std::complex<float> dot() const;
+    // |a[i]| and arg(a[i]). The vector forms use a polynomial atan2
+    // accurate to about 2e-6 rad.
+    void magnitudePhase();
+
+    void clearAccumulator();
+
+    // Element access in whatever layout is in use, for checking.
+    std::complex<float> a(std::size_t i) const;
+    std::complex<float> b(std::size_t i) const;
+    std::complex<float> accumulator(std::size_t i) const;
+    float magnitude(std::size_t i) const { return magnitude_[i]; }
+    float phase(std::size_t i) const { return phase_[i]; }
+
+private:
+    Variant variant_;
+    std::size_t n_;
+
+    // Only the arrays for variant_ are populated.
+    std::vector<std::complex<float>> ca_, cb_, cacc_;
+    std::vector<float> ia_, ib_, iacc_;             // 2n floats each
+    std::vector<float> ar_, ai_, br_, bi_, accr_, acci_;
+
+    std::vector<float> magnitude_, phase_;
+};
+
+} // namespace cplx
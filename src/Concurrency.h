@@ -0,0 +1,269 @@
+// Concurrency.h
+// Spin and ticket locks, bounded SPSC/MPMC queues and cache-line padding,
+// used by the concurrency-primitive benchmark.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace conc {
+
+// Spacing for data written by different threads. 128 rather than 64
+// bytes: Intel cores prefetch lines in adjacent pairs, and Apple cores
+// have 128-byte lines.
+constexpr std::size_t kCacheLine = 128;
+
+// A value alone on its cache line(s).
+template <typename T>
+struct alignas(kCacheLine) Padded {
+    T value{};
+};
+
+// Spin-wait hint: lets the sibling hyperthread run (x86 pause) or tells
+// the core it is spinning (Arm yield).
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || (defined(__arm__) && __ARM_ARCH >= 7)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// Spin-wait policy for one wait: a few relax hints, then give the core
+// away, so waiters still make progress when threads outnumber cores.
+class Backoff {
+public:
+    void pause()
+    {
+        if (spins_ < kSpinLimit)
+        {
+            ++spins_;
+            cpuRelax();
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    static constexpr int kSpinLimit = 64;
+    int spins_{0};
+};
+
+// Test-and-test-and-set: waiters spin on a plain load, so the line stays
+// shared until the holder writes it.
+class SpinLock {
+public:
+    void lock()
+    {
+        Backoff backoff;
+        while (locked_.exchange(true, std::memory_order_acquire))
+        {
+            while (locked_.load(std::memory_order_relaxed))
+            {
+                backoff.pause();
+            }
+        }
+    }
+
+    void unlock() { locked_.store(false, std::memory_order_release); }
+
+private:
+    std::atomic<bool> locked_{false};
+};
+
+// FIFO lock: each waiter takes a ticket and waits for its number. Fair,
+// but a preempted waiter stalls everyone queued behind it.
+class TicketLock {
+public:
+    void lock()
+    {
+        const uint32_t ticket = next_.fetch_add(1, std::memory_order_relaxed);
+        Backoff backoff;
+        while (serving_.load(std::memory_order_acquire) != ticket)
+        {
+            backoff.pause();
+        }
+    }
+
+    void unlock() { serving_.store(serving_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+private:
+    std::atomic<uint32_t> next_{0};
+    std::atomic<uint32_t> serving_{0};
+};
+
+inline std::size_t roundUpPow2(std::size_t n)
+{
+    std::size_t p = 1;
+    while (p < n)
+    {
+        p <<= 1;
+    }
+    return p;
+}
+
+// Bounded single-producer single-consumer ring. Each side keeps a copy of
+// the other side's index and only rereads it when the ring looks full
+// (or empty), so a steady stream touches the shared indices rarely.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(std::size_t capacity) : slots_(roundUpPow2(capacity)), mask_(slots_.size() - 1) {}
+
+    bool tryPush(const T &value)
+    {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head - cachedTail_ == slots_.size())
+        {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head - cachedTail_ == slots_.size())
+            {
+                return false;
+            }
+        }
+        slots_[head & mask_] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T &value)
+    {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == cachedHead_)
+        {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail == cachedHead_)
+            {
+                return false;
+            }
+        }
+        value = slots_[tail & mask_];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> slots_;
+    std::size_t mask_;
+    alignas(kCacheLine) std::atomic<std::size_t> head_{0}; // Producer side
+    std::size_t cachedTail_{0};
+    alignas(kCacheLine) std::atomic<std::size_t> tail_{0}; // Consumer side
+    std::size_t cachedHead_{0};
+};
+
+// Bounded multi-producer multi-consumer queue (Vyukov): every cell has a
+// sequence number telling producers and consumers whose turn it is, so
+// one CAS on the shared index claims a cell.
+template <typename T>
+class MpmcQueue {
+public:
+    explicit MpmcQueue(std::size_t capacity)
+        : size_(roundUpPow2(capacity)), mask_(size_ - 1), cells_(new Cell[size_])
+    {
+        for (std::size_t i = 0; i < size_; ++i)
+        {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool tryPush(const T &value)
+    {
+        std::size_t pos = enqueue_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell &cell = cells_[pos & mask_];
+            const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const std::intptr_t diff = std::intptr_t(sequence) - std::intptr_t(pos);
+            if (diff == 0)
+            {
+                if (enqueue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // Full
+            }
+            else
+            {
+                pos = enqueue_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T &value)
+    {
+        std::size_t pos = dequeue_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell &cell = cells_[pos & mask_];
+            const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const std::intptr_t diff = std::intptr_t(sequence) - std::intptr_t(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    value = cell.value;
+                    cell.sequence.store(pos + size_, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // Empty
+            }
+            else
+            {
+                pos = dequeue_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    std::size_t size_;
+    std::size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(kCacheLine) std::atomic<std::size_t> enqueue_{0};
+    alignas(kCacheLine) std::atomic<std::size_t> dequeue_{0};
+};
+
+// Blocking forms of tryPush/tryPop for either queue.
+template <typename Queue, typename T>
+void push(Queue &queue, const T &value)
+{
+    Backoff backoff;
+    while (!queue.tryPush(value))
+    {
+        backoff.pause();
+    }
+}
+
+template <typename T, typename Queue>
+T pop(Queue &queue)
+{
+    T value;
+    Backoff backoff;
+    while (!queue.tryPop(value))
+    {
+        backoff.pause();
+    }
+    return value;
+}
+
+} // namespace conc
@@ -0,0 +1,150 @@
+// CpuFeatures.cpp
+// Feature detection for x86-64, AArch64, 32-bit ARM and RISC-V.
+
+#include "CpuFeatures.h"
+
+#include "Simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#elif defined(__aarch64__) || defined(__arm__) || defined(__riscv)
+#include <sys/auxv.h>
+#if defined(__aarch64__) || defined(__arm__)
+#include <asm/hwcap.h>
+#endif
+#endif
+
+namespace cpu {
+
+namespace {
+
+Features detect()
+{
+    Features f;
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    bool ymmEnabled = false;
+    bool avx = false;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        f.sse42 = ecx & bit_SSE4_2;
+        f.aes = ecx & bit_AES;
+        f.clmul = ecx & bit_PCLMUL;
+        avx = ecx & bit_AVX;
+        f.fma = ecx & bit_FMA;
+        // The CPU may have AVX while the OS does not save YMM registers.
+        if (ecx & bit_OSXSAVE)
+        {
+            unsigned lo, hi;
+            __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+            ymmEnabled = (lo & 0x6) == 0x6;
+        }
+    }
+    f.fma = f.fma && ymmEnabled;
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+    {
+        f.avx2 = avx && ymmEnabled && (ebx & bit_AVX2);
+        f.sha = ebx & bit_SHA;
+    }
+#elif defined(__aarch64__)
+    const unsigned long caps = getauxval(AT_HWCAP);
+    f.neon = caps & HWCAP_ASIMD;
+    f.aes = caps & HWCAP_AES;
+    f.clmul = caps & HWCAP_PMULL;
+    f.sha = caps & HWCAP_SHA2;
+    f.crc32 = caps & HWCAP_CRC32;
+#if defined(HWCAP_ASIMDDP)
+    f.dotprod = caps & HWCAP_ASIMDDP;
+#endif
+#elif defined(__arm__)
+    // AArch32 reports the ARMv8 crypto/CRC extensions in AT_HWCAP2.
+    f.neon = getauxval(AT_HWCAP) & HWCAP_NEON;
+#if defined(AT_HWCAP2) && defined(HWCAP2_AES)
+    const unsigned long caps2 = getauxval(AT_HWCAP2);
+    f.aes = caps2 & HWCAP2_AES;
+    f.clmul = caps2 & HWCAP2_PMULL;
+    f.sha = caps2 & HWCAP2_SHA2;
+    f.crc32 = caps2 & HWCAP2_CRC32;
+#endif
+#elif defined(__riscv)
+    // Single-letter extensions are bits 'A'..'Z' of AT_HWCAP.
+    f.rvv = getauxval(AT_HWCAP) & (1UL << ('V' - 'A'));
+#endif
+    return f;
+}
+
+} // namespace
+
+const Features &features()
+{
+    static const Features detected = detect();
+    return detected;
+}
+
+std::string describe()
+{
+    const Features &f = features();
+    struct Name
+    {
+        bool present;
+        const char *name;
+    };
+#if defined(__x86_64__) || defined(__i386__)
+    const Name names[] = {{f.sse42, "sse4.2"}, {f.avx2, "avx2"}, {f.fma, "fma"},
+                          {f.aes, "aes"},      {f.clmul, "pclmul"}, {f.sha, "sha"}};
+#else
+    const Name names[] = {{f.neon, "neon"}, {f.aes, "aes"},         {f.clmul, "pmull"}, {f.sha, "sha2"},
+                          {f.crc32, "crc32"}, {f.dotprod, "dotprod"}, {f.rvv, "v"}};
+#endif
+
+    std::string result;
+    for (const Name &n : names)
+    {
+        if (n.present)
+        {
+            result += result.empty() ? "" : " ";
+            result += n.name;
+        }
+    }
+    return result.empty() ? "none" : result;
+}
+
+SimdLevel simdLevel()
+{
+#if defined(SIMD_AVX2_VARIANT)
+    if (features().avx2)
+    {
+        return SimdLevel::Avx2;
+    }
+#elif defined(SIMD_NEON_VARIANT)
+    if (features().neon)
+    {
+        return SimdLevel::Neon;
+    }
+#endif
+    return SimdLevel::Baseline;
+}
+
+const char *simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::Baseline:
+#if defined(__AVX2__)
+        return "AVX2";
+#elif defined(__SSE2__)
+        return "SSE2";
+#elif defined(__ARM_NEON)
+        return "NEON";
+#else
+        return "scalar";
+#endif
+    case SimdLevel::Avx2:
+        return "AVX2";
+    case SimdLevel::Neon:
+        return "NEON";
+    }
+    return "unknown";
+}
+
+} // namespace cpu
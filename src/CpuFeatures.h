@@ -0,0 +1,47 @@
+// CpuFeatures.h
+// Runtime CPU feature detection (cpuid on x86-64, AT_HWCAP on ARM and
+// RISC-V) and the SIMD level the vector kernels dispatch on.
+
+#pragma once
+
+#include <string>
+
+namespace cpu {
+
+// Instruction set extensions the benchmarks can use. Fields that do not
+// exist on the running architecture stay false.
+struct Features {
+    bool sse42{false};   // x86: SSE4.2 (includes the CRC32C instruction)
+    bool avx2{false};    // x86: AVX2, with OS support for YMM state
+    bool fma{false};     // x86: FMA3
+    bool neon{false};    // ARM: Advanced SIMD
+    bool aes{false};     // AES-NI / ARMv8 AES
+    bool clmul{false};   // PCLMULQDQ / ARMv8 PMULL
+    bool sha{false};     // SHA-NI / ARMv8 SHA2
+    bool crc32{false};   // ARMv8 CRC32 instructions
+    bool dotprod{false}; // ARMv8.2 SDOT/UDOT
+    bool rvv{false};     // RISC-V V extension
+};
+
+// Detected once on first use.
+const Features &features();
+
+// Space-separated names of the detected features, e.g. "avx2 fma aes".
+std::string describe();
+
+// Vector code paths the kernels are compiled for. Baseline is whatever
+// the build's -march gives; the others are extra variants built with
+// per-function target attributes and used only if the CPU has them.
+enum class SimdLevel {
+    Baseline,
+    Avx2, // x86-64 builds below AVX2: 8-wide float vectors
+    Neon  // 32-bit ARM builds without NEON (armv6): 4-wide NEON
+};
+
+// Best level available in this binary on this CPU.
+SimdLevel simdLevel();
+
+// Short label for result rows: "SSE2", "AVX2", "NEON", "scalar", ...
+const char *simdLevelName(SimdLevel level);
+
+} // namespace cpu
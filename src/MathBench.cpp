@@ -1,6 +1,25 @@
 #include "MathBench.h"
+#include "Aes.h"
+#include "Alloc.h"
+#include "BigInt.h"
+#include "Checksum.h"
+#include "Complex.h"
+#include "Concurrency.h"
+#include "CpuFeatures.h"
+#include "NBody.h"
+#include "Sha256.h"
+#include "Sparse.h"
+#include "Stats.h"
+#include "Storage.h"
+#include "Transform.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
 
 int MathBench::run(int argc, char **argv)
 {
@@ -8,12 +27,14 @@ int MathBench::run(int argc, char **argv)
     
     // Initialize UI
     ui_ = std::make_unique<UI>(threadCount_);
+    ui_->setCpuInfo(cpu::simdLevelName(cpu::simdLevel()), cpu::describe());
     ui_->init();
     
     runAllBenchmarks();
     
     // Cleanup
     ui_->cleanup();
+    ui_->printResults();
     
     return 0;
 }
@@ -39,21 +60,57 @@ void MathBench::parseArguments(int argc, char **argv)
     {
         threadCount_ = 1;
     }
+
+    // Optional second argument picks benchmark groups, e.g. "core,bigint".
+    if (argc > 2)
+    {
+        selectedBenchmark_ = argv[2];
+    }
+
+    // Optional third argument: where the "io" group puts its scratch file.
+    if (argc > 3)
+    {
+        scratchDirectory_ = argv[3];
+    }
+}
+
+bool MathBench::isSelected(const std::string &group) const
+{
+    std::istringstream groups(selectedBenchmark_);
+    std::string name;
+    while (std::getline(groups, name, ','))
+    {
+        if ((name == "all" && (group != "io" || !scratchDirectory_.empty())) || name == group)
+        {
+            return true;
+        }
+    }
+    return false;
 }
 
-void MathBench::executeBenchmark(const std::string &title, const std::function<double(int)> &worker, std::size_t iterations)
+BenchmarkResult MathBench::executeBenchmark(const std::string &title, const std::function<double(int)> &worker,
+                                            std::size_t iterations, const std::string &unit)
 {
     // Notify UI that benchmark is starting
     ui_->startBenchmark(title, iterations);
     
     std::vector<double> results(threadCount_, 0.0);
+    std::vector<std::string> errors(threadCount_);
     std::vector<std::thread> threads;
     threads.reserve(threadCount_);
 
     for (int i = 0; i < threadCount_; ++i)
     {
-        threads.emplace_back([i, &worker, &results]()
-                             { results[i] = worker(i); });
+        threads.emplace_back([i, &worker, &results, &errors]()
+                             {
+                                 try
+                                 {
+                                     results[i] = worker(i);
+                                 }
+                                 catch (const std::exception &e)
+                                 {
+                                     errors[i] = e.what();
+                                 } });
     }
 
     for (auto &t : threads)
@@ -78,30 +135,115 @@ void MathBench::executeBenchmark(const std::string &title, const std::function<d
     result.totalDuration = totalDuration;
     result.avgDuration = avgDuration;
     result.opsPerSec = opsPerSec;
+    result.unit = unit;
     result.iterations = iterations;
     result.completed = true;
+    for (const auto &error : errors)
+    {
+        if (!error.empty())
+        {
+            result.failed = true;
+            result.error = error;
+            break;
+        }
+    }
     
     // Update UI with results
     ui_->completeBenchmark(title, result);
     
     // Small delay to let user see the update
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    return result;
+}
+
+void MathBench::reportDerivedRate(const std::string &title, const BenchmarkResult &source, double iterations,
+                                  const std::string &unit)
+{
+    ui_->startBenchmark(title, std::size_t(iterations));
+
+    BenchmarkResult result = source;
+    result.name = title;
+    result.unit = unit;
+    result.iterations = std::size_t(iterations);
+    result.opsPerSec = iterations / source.avgDuration;
+    ui_->completeBenchmark(title, result);
+}
+
+void MathBench::reportAmount(const std::string &title, const BenchmarkResult &source, double amount,
+                             const std::string &unit)
+{
+    ui_->startBenchmark(title, 0);
+
+    BenchmarkResult result = source;
+    result.name = title;
+    result.unit = unit;
+    result.rate = false;
+    result.iterations = 0;
+    result.opsPerSec = amount;
+    ui_->completeBenchmark(title, result);
 }
 
 void MathBench::runAllBenchmarks()
 {
-    runBasicArithmeticBenchmark();
-    runTrigonometryBenchmark();
-    runLogarithmBenchmark();
-    runExponentialBenchmark();
-    runSquareRootBenchmark();
-    runSha256HashingBenchmark();
-    runSortingBenchmark();
-    runMatrixMultiplicationBenchmark();
-    runPrimeNumberBenchmark();
-    runFibonacciBenchmark();
-    runMonteCarloPiBenchmark();
-    runFourierTransformBenchmark();
+    if (isSelected("core"))
+    {
+        runBasicArithmeticBenchmark();
+        runTrigonometryBenchmark();
+        runLogarithmBenchmark();
+        runExponentialBenchmark();
+        runSquareRootBenchmark();
+        runSha256HashingBenchmark();
+        runSortingBenchmark();
+        runMatrixMultiplicationBenchmark();
+        runPrimeNumberBenchmark();
+        runFibonacciBenchmark();
+        runMonteCarloPiBenchmark();
+        runFourierTransformBenchmark();
+    }
+    if (isSelected("bigint"))
+    {
+        runBigIntegerBenchmark();
+    }
+    if (isSelected("aes"))
+    {
+        runAesEncryptionBenchmark();
+    }
+    if (isSelected("nbody"))
+    {
+        runDifferentialEquationBenchmark();
+    }
+    if (isSelected("stats"))
+    {
+        runStatisticalComputationBenchmark();
+    }
+    if (isSelected("transform"))
+    {
+        run3DTransformationBenchmark();
+    }
+    if (isSelected("complex"))
+    {
+        runComplexNumberBenchmark();
+    }
+    if (isSelected("spmv"))
+    {
+        runSparseMatrixVectorBenchmark();
+    }
+    if (isSelected("alloc"))
+    {
+        runAllocatorStressBenchmark();
+    }
+    if (isSelected("sync"))
+    {
+        runConcurrencyBenchmark();
+    }
+    if (isSelected("io"))
+    {
+        runStorageBenchmark();
+    }
+    if (isSelected("checksum"))
+    {
+        runChecksumBenchmark();
+    }
 }
 
 void MathBench::runBasicArithmeticBenchmark()
@@ -202,10 +344,36 @@ void MathBench::runLogarithmBenchmark()
                          return duration; }, iterations);
 }
 
+namespace
+{
+
+// The hardware backend must produce picosha2's digests, including at the
+// padding edges (55/56 bytes need one/two final blocks).
+void checkSha256Backend(sha256::Backend backend, const std::vector<uint8_t> &data)
+{
+    for (std::size_t len : {std::size_t(0), std::size_t(3), std::size_t(55), std::size_t(56), std::size_t(64),
+                            std::size_t(119), data.size()})
+    {
+        uint8_t digest[sha256::kDigestBytes];
+        uint8_t expected[sha256::kDigestBytes];
+        sha256::hash(backend, data.data(), len, digest);
+        picosha2::hash256(data.data(), data.data() + len, expected, expected + sha256::kDigestBytes);
+        if (!std::equal(digest, digest + sha256::kDigestBytes, expected))
+        {
+            throw std::runtime_error(std::string("SHA-256 ") + sha256::backendName(backend) +
+                                     " differs from picosha2");
+        }
+    }
+}
+
+} // namespace
+
+// Uses the SHA instructions (SHA-NI, ARMv8 SHA2) when the CPU has them.
 void MathBench::runSha256HashingBenchmark()
 {
     const std::size_t iterations = 100'000;
-    executeBenchmark("SHA-256 Hashing", [this, iterations](int)
+    const sha256::Backend backend = sha256::best();
+    executeBenchmark(std::string("SHA-256 Hashing ") + sha256::backendName(backend), [this, iterations, backend](int)
                      {
                          std::random_device rd;
                          std::mt19937 localEngine(rd());
@@ -221,11 +389,13 @@ void MathBench::runSha256HashingBenchmark()
                              return data;
                          };
 
+                         checkSha256Backend(backend, randData(256));
+
                          double duration = timeFunction([&]()
                                                         {
                              auto data = randData(256);
-                             std::vector<unsigned char> hash(picosha2::k_digest_size);
-                             picosha2::hash256(data.begin(), data.end(), hash.begin(), hash.end()); }, iterations);
+                             uint8_t hash[sha256::kDigestBytes];
+                             sha256::hash(backend, data.data(), data.size(), hash); }, iterations);
 
                          return duration; }, iterations);
 }
@@ -466,3 +636,1472 @@ void MathBench::runFourierTransformBenchmark()
 
                              return duration; }, iterations);
 }
+
+
+// Multiprecision arithmetic at RSA sizes. Run once with 32-bit limbs and
+// once with 64-bit limbs; on 32-bit cores the 64-bit limb products have to
+// be built from 32x32 multiplies, which is what makes TLS handshakes slow.
+void MathBench::runBigIntegerBenchmark()
+{
+    runBigIntegerSuite<uint32_t>(" (u32)");
+    runBigIntegerSuite<uint64_t>(" (u64)");
+}
+
+template <typename Limb>
+void MathBench::runBigIntegerSuite(const std::string &suffix)
+{
+    const std::size_t limbBits = sizeof(Limb) * 8;
+
+    auto randLimbs = [](std::mt19937 &engine, std::size_t n)
+    {
+        std::uniform_int_distribution<Limb> dist;
+        std::vector<Limb> value(n);
+        for (auto &limb : value)
+        {
+            limb = dist(engine);
+        }
+        return value;
+    };
+
+    // Odd modulus with the top bit set, like an RSA modulus.
+    auto randModulus = [randLimbs, limbBits](std::mt19937 &engine, std::size_t n)
+    {
+        auto modulus = randLimbs(engine, n);
+        modulus[0] |= 1;
+        modulus[n - 1] |= Limb(1) << (limbBits - 1);
+        return modulus;
+    };
+
+    // Operand strictly below any modulus produced above.
+    auto randOperand = [randLimbs](std::mt19937 &engine, std::size_t n)
+    {
+        auto value = randLimbs(engine, n);
+        value[n - 1] >>= 1;
+        return value;
+    };
+
+    // Plain multiplication: schoolbook vs Karatsuba on 2048-bit operands.
+    const std::size_t mulBits = 2048;
+    const std::size_t mulIterations = 20'000;
+    for (bool karatsuba : {false, true})
+    {
+        std::string title = "BigInt " + std::to_string(mulBits) +
+                            (karatsuba ? " Karatsuba" : " Schoolbook") + suffix;
+        executeBenchmark(title, [this, mulIterations, karatsuba, randLimbs, limbBits, mulBits](int)
+                         {
+                             std::random_device rd;
+                             std::mt19937 localEngine(rd());
+                             const std::size_t n = mulBits / limbBits;
+
+                             auto a = randLimbs(localEngine, n);
+                             auto b = randLimbs(localEngine, n);
+                             std::vector<Limb> product(2 * n);
+                             std::vector<Limb> reference(2 * n);
+                             std::vector<Limb> scratch(bigint::karatsubaScratchSize(n));
+
+                             bigint::mulSchoolbook(reference.data(), a.data(), b.data(), n);
+                             bigint::mulKaratsuba(product.data(), a.data(), b.data(), n, scratch.data());
+                             if (product != reference)
+                             {
+                                 throw std::runtime_error("Karatsuba product differs from schoolbook");
+                             }
+
+                             double duration = timeFunction([&]()
+                                                            {
+                                 if (karatsuba)
+                                 {
+                                     bigint::mulKaratsuba(product.data(), a.data(), b.data(), n, scratch.data());
+                                 }
+                                 else
+                                 {
+                                     bigint::mulSchoolbook(product.data(), a.data(), b.data(), n);
+                                 }
+                                 a[0] ^= product[n]; // Chain iterations together
+                             }, mulIterations);
+
+                             return duration; }, mulIterations);
+    }
+
+    // Montgomery modular multiplication, the inner step of modexp.
+    const std::size_t montIterations = 20'000;
+    executeBenchmark("BigInt " + std::to_string(mulBits) + " MontMul" + suffix,
+                     [this, montIterations, randModulus, randOperand, limbBits, mulBits](int)
+                     {
+                         std::random_device rd;
+                         std::mt19937 localEngine(rd());
+                         const std::size_t n = mulBits / limbBits;
+
+                         auto modulus = randModulus(localEngine, n);
+                         auto a = randOperand(localEngine, n);
+                         auto b = randOperand(localEngine, n);
+                         bigint::Montgomery<Limb> mont(modulus);
+
+                         // Check a*b mod m against a product reduced by long division.
+                         std::vector<Limb> product(2 * n);
+                         std::vector<Limb> expected(n);
+                         std::vector<Limb> actual(n);
+                         bigint::mulSchoolbook(product.data(), a.data(), b.data(), n);
+                         bigint::modReference(expected.data(), product.data(), modulus.data(), n);
+                         mont.toMontgomery(a.data(), a.data());
+                         mont.toMontgomery(b.data(), b.data());
+                         mont.mul(actual.data(), a.data(), b.data());
+                         mont.fromMontgomery(actual.data(), actual.data());
+                         if (actual != expected)
+                         {
+                             throw std::runtime_error("Montgomery product differs from reference");
+                         }
+
+                         double duration = timeFunction([&]()
+                                                        { mont.mul(a.data(), a.data(), b.data()); }, montIterations);
+
+                         return duration; }, montIterations);
+
+    // Full-length exponents, i.e. an RSA private-key operation without CRT.
+    const std::pair<std::size_t, std::size_t> expSizes[] = {{1024, 50}, {2048, 10}, {4096, 2}};
+    for (const auto &size : expSizes)
+    {
+        const std::size_t bits = size.first;
+        const std::size_t iterations = size.second;
+        executeBenchmark("BigInt ModExp " + std::to_string(bits) + suffix,
+                         [this, bits, iterations, randLimbs, randModulus, randOperand, limbBits](int)
+                         {
+                             std::random_device rd;
+                             std::mt19937 localEngine(rd());
+                             const std::size_t n = bits / limbBits;
+
+                             auto modulus = randModulus(localEngine, n);
+                             auto base = randOperand(localEngine, n);
+                             auto exponent = randLimbs(localEngine, n);
+                             bigint::Montgomery<Limb> mont(modulus);
+                             std::vector<Limb> result(n);
+
+                             // Verify the windowed ladder on a one-limb exponent
+                             // against square-and-multiply with long division.
+                             {
+                                 const Limb shortExp = exponent[0];
+                                 std::vector<Limb> expected(n, 0);
+                                 std::vector<Limb> product(2 * n);
+                                 expected[0] = 1;
+                                 for (std::size_t bit = limbBits; bit-- > 0;)
+                                 {
+                                     bigint::mulSchoolbook(product.data(), expected.data(), expected.data(), n);
+                                     bigint::modReference(expected.data(), product.data(), modulus.data(), n);
+                                     if ((shortExp >> bit) & 1)
+                                     {
+                                         bigint::mulSchoolbook(product.data(), expected.data(), base.data(), n);
+                                         bigint::modReference(expected.data(), product.data(), modulus.data(), n);
+                                     }
+                                 }
+                                 mont.modExp(result.data(), base.data(), &shortExp, 1);
+                                 if (result != expected)
+                                 {
+                                     throw std::runtime_error("Modular exponentiation differs from reference");
+                                 }
+                             }
+
+                             double duration = timeFunction([&]()
+                                                            {
+                                 mont.modExp(result.data(), base.data(), exponent.data(), n);
+                                 base[0] ^= result[0] & 1; // Chain iterations together
+                             }, iterations);
+
+                             return duration; }, iterations);
+    }
+}
+
+namespace
+{
+
+// FIPS-197 appendix C.1 / C.3 and GCM test case 2 (McGrew & Viega).
+void checkAesKnownAnswers(aes::Backend backend)
+{
+    uint8_t key[32];
+    uint8_t plain[16];
+    for (int i = 0; i < 32; ++i)
+    {
+        key[i] = static_cast<uint8_t>(i);
+    }
+    for (int i = 0; i < 16; ++i)
+    {
+        plain[i] = static_cast<uint8_t>(i * 0x11);
+    }
+
+    const uint8_t expected128[16] = {0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+                                     0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a};
+    const uint8_t expected256[16] = {0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf,
+                                     0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89};
+    const uint8_t expectedTag[16] = {0xab, 0x6e, 0x47, 0xd4, 0x2c, 0xec, 0x13, 0xbd,
+                                     0xf5, 0x3a, 0x67, 0xb2, 0x12, 0x57, 0xbd, 0xdf};
+
+    uint8_t out[16];
+    aes::Context(backend, key, 16).encryptBlock(out, plain);
+    bool ok = std::equal(out, out + 16, expected128);
+    aes::Context(backend, key, 32).encryptBlock(out, plain);
+    ok = ok && std::equal(out, out + 16, expected256);
+
+    uint8_t zero[16] = {};
+    uint8_t tag[16];
+    aes::Context(backend, zero, 16).gcmEncrypt(out, tag, zero, 16, zero, nullptr, 0);
+    ok = ok && std::equal(tag, tag + 16, expectedTag);
+
+    if (!ok)
+    {
+        throw std::runtime_error(std::string("AES known-answer test failed for ") + aes::backendName(backend));
+    }
+}
+
+} // namespace
+
+// Bulk encryption throughput in MB/s for every AES backend this CPU can
+// run: portable T-tables, constant-time bitslicing and AES-NI / ARMv8
+// Crypto Extensions. Small buffers show per-call overhead (IV setup, GCM
+// length block), large ones the sustained stream rate.
+void MathBench::runAesEncryptionBenchmark()
+{
+    struct Case
+    {
+        bool gcm;
+        std::size_t keyBytes;
+        std::size_t bufferSize;
+        const char *sizeLabel;
+    };
+    const Case cases[] = {
+        {false, 16, 64, "64B"},
+        {false, 16, 16 * 1024, "16K"},
+        {false, 16, 1024 * 1024, "1M"},
+        {false, 32, 16 * 1024, "16K"},
+        {true, 16, 64, "64B"},
+        {true, 16, 16 * 1024, "16K"},
+        {true, 16, 1024 * 1024, "1M"},
+        {true, 32, 16 * 1024, "16K"},
+    };
+    // Bytes per row, scaled to the backend's speed so every row runs for
+    // at least ~100 ms: a few hundred MB/s for the table and tens for the
+    // bitsliced code, several GB/s for the hardware on a desktop core.
+    auto bytesPerRow = [](aes::Backend backend) -> std::size_t
+    {
+        switch (backend)
+        {
+        case aes::Backend::Table:
+            return 32 * 1024 * 1024;
+        case aes::Backend::Bitsliced:
+            return 8 * 1024 * 1024;
+        case aes::Backend::Hardware:
+            return 512 * 1024 * 1024;
+        }
+        return 0;
+    };
+
+    for (aes::Backend backend : {aes::Backend::Table, aes::Backend::Bitsliced, aes::Backend::Hardware})
+    {
+        if (!aes::available(backend))
+        {
+            continue;
+        }
+
+        for (const Case &c : cases)
+        {
+            const std::size_t passes = bytesPerRow(backend) / c.bufferSize;
+            const std::size_t iterations = passes * c.bufferSize;
+            std::string title = std::string("AES-") + (c.keyBytes == 16 ? "128" : "256") +
+                                (c.gcm ? "-GCM " : "-CTR ") + c.sizeLabel + " " + aes::backendName(backend);
+
+            executeBenchmark(title, [this, backend, c, passes](int)
+                             {
+                                 checkAesKnownAnswers(backend);
+
+                                 std::random_device rd;
+                                 std::mt19937 localEngine(rd());
+                                 std::uniform_int_distribution<int> byteDist(0, 255);
+
+                                 std::vector<uint8_t> key(c.keyBytes);
+                                 std::vector<uint8_t> iv(16);
+                                 std::vector<uint8_t> input(c.bufferSize);
+                                 std::vector<uint8_t> output(c.bufferSize);
+                                 for (auto *bytes : {&key, &iv, &input})
+                                 {
+                                     for (auto &b : *bytes)
+                                     {
+                                         b = static_cast<uint8_t>(byteDist(localEngine));
+                                     }
+                                 }
+                                 uint8_t tag[16];
+
+                                 aes::Context context(backend, key.data(), key.size());
+                                 auto encrypt = [&](const aes::Context &ctx, uint8_t *out)
+                                 {
+                                     if (c.gcm)
+                                     {
+                                         ctx.gcmEncrypt(out, tag, input.data(), input.size(), iv.data(), nullptr, 0);
+                                     }
+                                     else
+                                     {
+                                         ctx.ctr(out, input.data(), input.size(), iv.data());
+                                     }
+                                 };
+
+                                 // Every backend must agree with the portable one.
+                                 if (backend != aes::Backend::Table)
+                                 {
+                                     aes::Context reference(aes::Backend::Table, key.data(), key.size());
+                                     std::vector<uint8_t> expected(c.bufferSize);
+                                     uint8_t expectedTag[16];
+                                     encrypt(reference, expected.data());
+                                     std::copy(tag, tag + 16, expectedTag);
+                                     encrypt(context, output.data());
+                                     if (output != expected || !std::equal(tag, tag + 16, expectedTag))
+                                     {
+                                         throw std::runtime_error("AES output differs from table backend");
+                                     }
+                                 }
+
+                                 double duration = timeFunction([&]()
+                                                                {
+                                     encrypt(context, output.data());
+                                     iv[0] ^= output[0]; // Chain iterations together
+                                 }, passes);
+
+                                 return duration; }, iterations, "B");
+        }
+    }
+}
+
+namespace
+{
+
+// RK4 at this step size conserves energy to far better than this; a
+// larger drift means a broken kernel or a race between force passes.
+constexpr double kMaxEnergyDrift = 1e-5;
+
+void checkEnergyDrift(double before, double after)
+{
+    if (std::abs(after - before) > kMaxEnergyDrift * std::abs(before))
+    {
+        std::ostringstream message;
+        message << "N-body energy drifted from " << before << " to " << after;
+        throw std::runtime_error(message.str());
+    }
+}
+
+} // namespace
+
+// Gravitational N-body system integrated with RK4. The first rows compare
+// force-kernel layouts on one system per thread; the MT rows share one
+// system between all threads, each evaluating forces for its own slice of
+// bodies, and sweep N from cache-resident to well past L2.
+void MathBench::runDifferentialEquationBenchmark()
+{
+    const float dt = 1e-3f;
+    const std::size_t layoutBodies = 1024;
+    const int layoutSteps = 8;
+
+    for (nbody::Kernel kernel : {nbody::Kernel::AoS, nbody::Kernel::SoA, nbody::Kernel::SoAVector})
+    {
+        std::string title = std::string("N-body ") + nbody::kernelName(kernel) + " " + std::to_string(layoutBodies);
+        std::size_t iterations = std::size_t(layoutSteps * 4.0 * layoutBodies * layoutBodies);
+
+        executeBenchmark(title, [this, kernel, layoutBodies, layoutSteps, dt](int)
+                         {
+                             std::random_device rd;
+                             nbody::Simulation sim(kernel, layoutBodies, dt, rd());
+                             double before = sim.energy();
+
+                             double duration = timeFunction([&]()
+                                                            { sim.step(); }, layoutSteps);
+
+                             checkEnergyDrift(before, sim.energy());
+                             return duration; }, iterations, "pair");
+    }
+
+    for (std::size_t n : {256, 1024, 4096, 16384})
+    {
+        nbody::Simulation sim(nbody::Kernel::SoAVector, n, dt, 42);
+        const int steps = int(std::max(1.0, double(1 << 26) / sim.interactionsPerStep()));
+        const double before = sim.energy();
+        Barrier barrier(threadCount_);
+        std::size_t iterations = std::size_t(steps * sim.interactionsPerStep());
+
+        // Every thread runs all steps on its slice, so the per-thread time
+        // is the wall time of the whole job and the rate is the aggregate.
+        std::string title = std::string("N-body MT ") + cpu::simdLevelName(cpu::simdLevel()) + " " + std::to_string(n);
+        executeBenchmark(title, [this, &sim, &barrier, steps, before](int threadIndex)
+                         {
+                             barrier.wait();
+                             double duration = timeFunction([&]()
+                                                            { sim.step(threadIndex, threadCount_, &barrier); }, steps);
+
+                             barrier.wait();
+                             if (threadIndex == 0)
+                             {
+                                 checkEnergyDrift(before, sim.energy());
+                             }
+                             return duration; }, iterations, "pair");
+    }
+}
+
+namespace
+{
+
+// Telemetry-like samples: mostly normal, all inside the histogram range.
+std::vector<float> makeSamples(std::size_t n, uint32_t seed)
+{
+    std::mt19937 engine(seed);
+    std::normal_distribution<float> dist(100.0f, 15.0f);
+    std::vector<float> samples(n);
+    for (auto &x : samples)
+    {
+        x = std::min(std::max(dist(engine), 0.0f), 199.0f);
+    }
+    return samples;
+}
+
+// Two-pass double-precision reference.
+stats::Moments referenceMoments(const std::vector<float> &samples)
+{
+    stats::Moments m;
+    m.count = samples.size();
+    m.min = *std::min_element(samples.begin(), samples.end());
+    m.max = *std::max_element(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (float x : samples)
+    {
+        sum += x;
+    }
+    m.mean = sum / double(samples.size());
+    for (float x : samples)
+    {
+        m.m2 += (x - m.mean) * (x - m.mean);
+    }
+    return m;
+}
+
+void checkMoments(const stats::Moments &got, const stats::Moments &expected)
+{
+    if (got.count != expected.count || got.min != expected.min || got.max != expected.max ||
+        std::abs(got.mean - expected.mean) > 1e-6 * std::abs(expected.mean) ||
+        std::abs(got.variance() - expected.variance()) > 1e-5 * expected.variance())
+    {
+        std::ostringstream message;
+        message << "moments differ from reference: mean " << got.mean << " vs " << expected.mean
+                << ", variance " << got.variance() << " vs " << expected.variance();
+        throw std::runtime_error(message.str());
+    }
+}
+
+} // namespace
+
+// Mean/variance/min/max, histograms and quantiles over telemetry-sized
+// arrays, in bytes of input per second. Each thread streams its own 16 MB
+// array; the MT row splits one 64 MB array between all threads and merges
+// the per-thread moments in a tree.
+void MathBench::runStatisticalComputationBenchmark()
+{
+    const std::size_t samples = 4 * 1024 * 1024;
+    const std::size_t bytes = samples * sizeof(float);
+
+    struct Case
+    {
+        const char *title;
+        int passes;
+    };
+    const Case cases[] = {
+        {"Stats Welford 16 MB", 2},
+        {"Stats Blocked Welford 16 MB", 8},
+        {"Stats Histogram 16 MB", 4},
+        {"Stats P2 p50/p99 16 MB", 1},
+    };
+
+    for (std::size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c)
+    {
+        const int passes = cases[c].passes;
+        executeBenchmark(cases[c].title, [this, c, passes, samples](int)
+                         {
+                             std::random_device rd;
+                             std::vector<float> data = makeSamples(samples, rd());
+                             const stats::Moments expected = referenceMoments(data);
+                             double duration = 0.0;
+
+                             if (c == 0 || c == 1)
+                             {
+                                 auto reduce = c == 0 ? stats::welford : stats::blockedWelford;
+                                 stats::Moments m;
+                                 duration = timeFunction([&]()
+                                                         { m = reduce(data.data(), data.size()); }, passes);
+                                 checkMoments(m, expected);
+                             }
+                             else if (c == 2)
+                             {
+                                 stats::Histogram histogram(256, 0.0, 200.0);
+                                 duration = timeFunction([&]()
+                                                         { histogram.add(data.data(), data.size()); }, passes);
+                                 if (histogram.total() != uint64_t(passes) * data.size() ||
+                                     histogram.underflow() + histogram.overflow() != 0)
+                                 {
+                                     throw std::runtime_error("histogram lost samples");
+                                 }
+                             }
+                             else
+                             {
+                                 stats::P2Quantile p50(0.5), p99(0.99);
+                                 duration = timeFunction([&]()
+                                                         {
+                                     for (float x : data)
+                                     {
+                                         p50.add(x);
+                                         p99.add(x);
+                                     } }, passes);
+
+                                 // Sketch against exact order statistics, in units of sigma.
+                                 const double sigma = std::sqrt(expected.variance());
+                                 auto exact = [&](double p)
+                                 {
+                                     std::size_t k = std::size_t(p * double(data.size() - 1));
+                                     std::nth_element(data.begin(), data.begin() + k, data.end());
+                                     return double(data[k]);
+                                 };
+                                 if (std::abs(p50.value() - exact(0.5)) > 0.02 * sigma ||
+                                     std::abs(p99.value() - exact(0.99)) > 0.05 * sigma)
+                                 {
+                                     throw std::runtime_error("P2 quantile estimate out of tolerance");
+                                 }
+                             }
+                             return duration; }, passes * bytes, "B");
+    }
+
+    // One shared array; each thread reduces its slice, then partials are
+    // merged pairwise in log2(threads) rounds.
+    const std::size_t sharedSamples = 16 * 1024 * 1024;
+    const int sharedPasses = 8;
+    const std::vector<float> data = makeSamples(sharedSamples, 42);
+    const stats::Moments expected = referenceMoments(data);
+    std::vector<stats::Moments> partials(threadCount_);
+    Barrier barrier(threadCount_);
+
+    executeBenchmark("Stats MT Reduce 64 MB", [this, &data, &expected, &partials, &barrier, sharedPasses](int threadIndex)
+                     {
+                         const std::size_t begin = data.size() * threadIndex / threadCount_;
+                         const std::size_t end = data.size() * (threadIndex + 1) / threadCount_;
+                         barrier.wait();
+                         double duration = timeFunction([&]()
+                                                        {
+                             partials[threadIndex] = stats::blockedWelford(data.data() + begin, end - begin);
+                             stats::reduceTree(partials, threadIndex, threadCount_, barrier); }, sharedPasses);
+
+                         if (threadIndex == 0)
+                         {
+                             checkMoments(partials[0], expected);
+                         }
+                         return duration; }, sharedPasses * sharedSamples * sizeof(float), "B");
+}
+
+namespace
+{
+
+// Double-precision recomputation of a sample of vertices.
+void checkTransform(const xform::VertexBuffer &buffer, const xform::Matrix4 &mvp, const float normal[9])
+{
+    for (std::size_t i = 0; i < buffer.size(); i += 97)
+    {
+        float in[6], out[6];
+        buffer.input(i, in);
+        buffer.output(i, out);
+
+        double clip[4];
+        for (int r = 0; r < 4; ++r)
+        {
+            clip[r] = double(mvp.m[r]) * in[0] + double(mvp.m[4 + r]) * in[1] + double(mvp.m[8 + r]) * in[2] +
+                      mvp.m[12 + r];
+        }
+        double expected[6];
+        for (int r = 0; r < 3; ++r)
+        {
+            expected[r] = clip[r] / clip[3];
+            expected[3 + r] = double(normal[r]) * in[3] + double(normal[3 + r]) * in[4] + double(normal[6 + r]) * in[5];
+        }
+        for (int k = 0; k < 6; ++k)
+        {
+            if (std::abs(out[k] - expected[k]) > 1e-5 * std::max(1.0, std::abs(expected[k])))
+            {
+                throw std::runtime_error("transformed vertex differs from reference");
+            }
+        }
+    }
+}
+
+} // namespace
+
+// Model-view-projection and normal transforms over vertex buffers, in
+// vertices per second. The first rows compare layouts and kernels on a
+// cache-resident buffer per thread; the MT rows split one shared buffer
+// between the threads, at sizes from L2-resident to DRAM-bound.
+void MathBench::run3DTransformationBenchmark()
+{
+    const xform::Matrix4 model = xform::multiply(xform::translation(0.0f, 0.0f, -5.0f),
+                                                 xform::rotation(0.5f, 0.57735f, 0.57735f, 0.57735f));
+    const xform::Matrix4 mvp = xform::multiply(xform::perspective(1.0f, 16.0f / 9.0f, 0.1f, 100.0f), model);
+    float normal[9];
+    xform::normalMatrix(model, normal);
+
+    const std::size_t verticesPerRow = 16 * 1024 * 1024;
+    const xform::Layout layouts[] = {xform::Layout::AoS, xform::Layout::SoA, xform::Layout::AoSoA};
+
+    const std::size_t localVertices = 16 * 1024;
+    for (xform::Layout layout : layouts)
+    {
+        for (bool vectorised : {false, true})
+        {
+            std::string title = std::string("Transform ") + xform::layoutName(layout) +
+                                (vectorised ? std::string(" ") + xform::simdName(layout) : "") + " 16K";
+            const std::size_t passes = verticesPerRow / localVertices;
+
+            executeBenchmark(title, [this, &mvp, &normal, layout, vectorised, localVertices, passes](int)
+                             {
+                                 std::random_device rd;
+                                 xform::VertexBuffer buffer(layout, localVertices, rd());
+                                 double duration = timeFunction([&]()
+                                                                { buffer.transform(mvp, normal, vectorised, 0, localVertices); }, passes);
+                                 checkTransform(buffer, mvp, normal);
+                                 return duration; }, verticesPerRow, "vtx");
+        }
+    }
+
+    // Every thread transforms its own contiguous slice of the shared
+    // buffer, pass after pass, so no two threads ever write the same
+    // vertices. Slices start on 64-vertex boundaries: whole AoSoA blocks
+    // and whole cache lines in every layout. Passes are independent, so
+    // there is no barrier between them; the ones around the timed loop
+    // make each thread's time the wall time of the row.
+    const std::size_t sliceAlign = 64;
+    struct Size
+    {
+        std::size_t vertices;
+        const char *label;
+    };
+    for (const Size &size : {Size{4 * 1024, "4K"}, Size{64 * 1024, "64K"}, Size{1024 * 1024, "1M"}})
+    {
+        for (xform::Layout layout : layouts)
+        {
+            xform::VertexBuffer buffer(layout, size.vertices, 42);
+            const std::size_t passes = verticesPerRow / size.vertices;
+            const std::size_t units = size.vertices / sliceAlign;
+            Barrier barrier(threadCount_);
+
+            std::string title = std::string("Transform MT ") + xform::layoutName(layout) + " " + xform::simdName(layout) +
+                                " " + size.label;
+            executeBenchmark(title, [&, passes, units](int threadIndex)
+                             {
+                                 const std::size_t begin = units * threadIndex / threadCount_ * sliceAlign;
+                                 const std::size_t end = units * (threadIndex + 1) / threadCount_ * sliceAlign;
+                                 barrier.wait();
+                                 double duration = timeFunction([&]()
+                                                                {
+                                     if (begin < end)
+                                     {
+                                         for (std::size_t pass = 0; pass < passes; ++pass)
+                                         {
+                                             buffer.transform(mvp, normal, true, begin, end);
+                                         }
+                                     }
+                                     barrier.wait(); }, 1);
+
+                                 if (threadIndex == 0)
+                                 {
+                                     checkTransform(buffer, mvp, normal);
+                                 }
+                                 return duration; }, verticesPerRow, "vtx");
+        }
+    }
+}
+
+namespace
+{
+
+enum class ComplexOp
+{
+    MultiplyAccumulate,
+    Dot,
+    MagnitudePhase
+};
+
+// Runs op once on fresh buffers and compares every element with a
+// double-precision reference.
+void checkComplexKernel(cplx::Buffers &buffers, ComplexOp op)
+{
+    const std::size_t n = buffers.size();
+    std::complex<double> sum;
+    double scale = 0.0;
+    if (op == ComplexOp::MultiplyAccumulate)
+    {
+        buffers.clearAccumulator();
+        buffers.multiplyAccumulate();
+    }
+    else if (op == ComplexOp::MagnitudePhase)
+    {
+        buffers.magnitudePhase();
+    }
+
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const std::complex<double> a(buffers.a(i)), b(buffers.b(i));
+        bool ok = true;
+        switch (op)
+        {
+        case ComplexOp::MultiplyAccumulate:
+            ok = std::abs(std::complex<double>(buffers.accumulator(i)) - a * b) < 1e-5;
+            break;
+        case ComplexOp::Dot:
+            sum += std::conj(a) * b;
+            scale += std::abs(a) * std::abs(b);
+            break;
+        case ComplexOp::MagnitudePhase:
+            ok = std::abs(buffers.magnitude(i) - std::abs(a)) < 1e-5 &&
+                 std::abs(buffers.phase(i) - std::arg(a)) < 1e-5;
+            break;
+        }
+        if (!ok)
+        {
+            throw std::runtime_error("complex kernel differs from reference");
+        }
+    }
+    if (op == ComplexOp::Dot && std::abs(std::complex<double>(buffers.dot()) - sum) > 1e-4 * scale)
+    {
+        throw std::runtime_error("complex dot product differs from reference");
+    }
+}
+
+} // namespace
+
+// Complex multiply-accumulate, conjugated dot product and magnitude/phase
+// on 4096-element arrays per thread, in complex results per second.
+// Compares std::complex with hand-written interleaved and split re/im
+// layouts, each scalar and SIMD.
+void MathBench::runComplexNumberBenchmark()
+{
+    const std::size_t elements = 4096;
+    struct Op
+    {
+        ComplexOp op;
+        const char *name;
+        std::size_t total;
+    };
+    const Op ops[] = {
+        {ComplexOp::MultiplyAccumulate, "MAC", std::size_t(1) << 24},
+        {ComplexOp::Dot, "Dot", std::size_t(1) << 24},
+        {ComplexOp::MagnitudePhase, "Abs", std::size_t(1) << 22},
+    };
+    const cplx::Variant variants[] = {cplx::Variant::StdComplex, cplx::Variant::Interleaved,
+                                      cplx::Variant::InterleavedVector, cplx::Variant::Split,
+                                      cplx::Variant::SplitVector};
+
+    for (const Op &op : ops)
+    {
+        for (cplx::Variant variant : variants)
+        {
+            std::string title = std::string("Complex ") + op.name + " " + cplx::variantName(variant);
+            const std::size_t passes = op.total / elements;
+
+            executeBenchmark(title, [this, op, variant, elements, passes](int)
+                             {
+                                 std::random_device rd;
+                                 cplx::Buffers buffers(variant, elements, rd());
+                                 checkComplexKernel(buffers, op.op);
+
+                                 std::complex<float> sink;
+                                 double duration = timeFunction([&]()
+                                                                {
+                                     switch (op.op)
+                                     {
+                                     case ComplexOp::MultiplyAccumulate:
+                                         buffers.multiplyAccumulate();
+                                         break;
+                                     case ComplexOp::Dot:
+                                         sink += buffers.dot();
+                                         break;
+                                     case ComplexOp::MagnitudePhase:
+                                         buffers.magnitudePhase();
+                                         break;
+                                     } }, passes);
+
+                                 if (!std::isfinite(sink.real()) || !std::isfinite(sink.imag()))
+                                 {
+                                     throw std::runtime_error("complex dot product overflowed");
+                                 }
+                                 return duration; }, op.total);
+        }
+    }
+}
+
+// y = A x in double precision on generated 256K x 256K matrices, shared by
+// all threads. Rows are split between threads by nonzero count (slices for
+// SELL), so one thread is the single-threaded case. Each format gets a
+// GFLOP/s row (2 per nonzero) and an effective bandwidth row (matrix, x
+// and y each moved once).
+void MathBench::runSparseMatrixVectorBenchmark()
+{
+    const std::size_t rows = 256 * 1024;
+    // Work per benchmark row, in FLOPs; sets the number of passes.
+    const double flopBudget = double(std::size_t(1) << 27);
+
+    struct Matrix
+    {
+        const char *name;
+        std::function<sparse::Csr()> build;
+        bool ell; // Padding every row to the longest is only sane for even rows
+    };
+    const Matrix matrices[] = {
+        {"banded", [rows]() { return sparse::banded(rows, 8, 1); }, true},
+        {"random", [rows]() { return sparse::randomUniform(rows, 16, 2); }, true},
+        {"powerlaw", [rows]() { return sparse::powerLaw(rows, 16, 4096, 3); }, false},
+    };
+
+    for (const Matrix &matrix : matrices)
+    {
+        const sparse::Csr csr = matrix.build();
+        std::mt19937 engine(4);
+        std::uniform_real_distribution<double> value(-1.0, 1.0);
+        std::vector<double> x(csr.cols);
+        for (auto &v : x)
+        {
+            v = value(engine);
+        }
+        std::vector<double> expected(rows);
+        csr.multiply(x.data(), expected.data(), 0, rows);
+
+        const double flops = 2.0 * double(csr.nnz());
+        const int passes = std::max(1, int(flopBudget / flops));
+
+        // Runs one format with the given per-thread ranges; all threads
+        // start together and stop the clock once the slowest is done.
+        auto run = [&](const std::string &format, double bytes,
+                       const std::vector<std::pair<std::size_t, std::size_t>> &ranges,
+                       const std::function<void(double *, std::size_t, std::size_t)> &multiply, bool bandwidth)
+        {
+            std::vector<double> y(rows, 0.0);
+            Barrier barrier(threadCount_);
+            std::string title = "SpMV " + format + " " + matrix.name;
+
+            BenchmarkResult result = executeBenchmark(title, [&](int threadIndex)
+                                                      {
+                                                          const std::size_t begin = ranges[threadIndex].first;
+                                                          const std::size_t end = ranges[threadIndex].second;
+                                                          barrier.wait();
+                                                          double duration = timeFunction([&]()
+                                                                                         {
+                                                              for (int p = 0; p < passes; ++p)
+                                                              {
+                                                                  multiply(y.data(), begin, end);
+                                                              }
+                                                              barrier.wait(); }, 1);
+
+                                                          if (threadIndex == 0)
+                                                          {
+                                                              for (std::size_t r = 0; r < rows; ++r)
+                                                              {
+                                                                  if (std::abs(y[r] - expected[r]) > 1e-9 * (1.0 + std::abs(expected[r])))
+                                                                  {
+                                                                      throw std::runtime_error("SpMV result differs from CSR reference");
+                                                                  }
+                                                              }
+                                                          }
+                                                          return duration; }, std::size_t(passes * flops), "FLOP");
+            if (bandwidth)
+            {
+                reportDerivedRate(title + " B/W", result, passes * bytes, "B");
+            }
+        };
+
+        run("CSR", csr.bytes(), sparse::balancedSplit(csr.rowPtr, threadCount_),
+            [&](double *y, std::size_t begin, std::size_t end) { csr.multiply(x.data(), y, begin, end); }, true);
+
+        if (!matrix.ell)
+        {
+            // Equal row counts per thread: with skewed rows the thread that
+            // gets the long ones holds everybody up.
+            run("CSR row-split", csr.bytes(), sparse::uniformSplit(rows, threadCount_),
+                [&](double *y, std::size_t begin, std::size_t end) { csr.multiply(x.data(), y, begin, end); }, false);
+        }
+        else
+        {
+            const sparse::Ell ell(csr);
+            run("ELL", ell.bytes(), sparse::uniformSplit(rows, threadCount_),
+                [&](double *y, std::size_t begin, std::size_t end) { ell.multiply(x.data(), y, begin, end); }, true);
+        }
+
+        const sparse::Sell sell(csr, 256);
+        run("SELL-8", sell.bytes(), sparse::balancedSplit(sell.slicePtr(), threadCount_),
+            [&](double *y, std::size_t begin, std::size_t end) { sell.multiply(x.data(), y, begin, end); }, true);
+    }
+}
+
+// Allocation throughput and memory footprint of system malloc, a bump
+// arena and per-thread size-class pools (see Alloc.h). Each row has a
+// companion RSS row: the peak resident memory above what the process
+// held when the row started, for all threads together. RSS rows are left
+// out where the kernel cannot reset the peak.
+void MathBench::runAllocatorStressBenchmark()
+{
+    auto run = [this](const std::string &title, std::size_t allocations, const std::function<double(int)> &worker)
+    {
+        const bool peakReset = alloc::resetPeakResident();
+        const std::size_t before = alloc::residentBytes();
+        const BenchmarkResult result = executeBenchmark(title, worker, allocations, "obj");
+        if (peakReset && !result.failed)
+        {
+            const std::size_t peak = alloc::peakResidentBytes();
+            reportAmount(title + " RSS", result, double(peak > before ? peak - before : 0), "B");
+        }
+    };
+    auto check = [](std::size_t corrupted)
+    {
+        if (corrupted)
+        {
+            throw std::runtime_error(std::to_string(corrupted) + " blocks were overwritten while in use");
+        }
+    };
+
+    const alloc::Kind kinds[] = {alloc::Kind::Malloc, alloc::Kind::Arena, alloc::Kind::Pool};
+
+    const std::size_t smallAllocations = std::size_t(1) << 23;
+    for (alloc::Kind kind : kinds)
+    {
+        run(std::string("Alloc small ") + alloc::kindName(kind), smallAllocations, [&, kind](int threadIndex)
+            {
+                std::size_t corrupted = 0;
+                double duration = timeFunction([&]()
+                                               { corrupted = alloc::smallChurn(kind, smallAllocations, uint32_t(threadIndex)); }, 1);
+                check(corrupted);
+                return duration; });
+    }
+
+    // Everyone starts together and finishes together (the last thread's
+    // frees reach the first thread's pool), so times are wall times.
+    const std::size_t handoffAllocations = std::size_t(1) << 22;
+    for (alloc::Kind kind : {alloc::Kind::Malloc, alloc::Kind::Pool})
+    {
+        alloc::Handoff handoff(threadCount_);
+        Barrier barrier(threadCount_);
+        run(std::string("Alloc handoff ") + alloc::kindName(kind), handoffAllocations, [&, kind](int threadIndex)
+            {
+                std::size_t corrupted = 0;
+                barrier.wait();
+                double duration = timeFunction([&]()
+                                               { corrupted = handoff.run(kind, threadIndex, handoffAllocations, uint32_t(threadIndex)); }, 1);
+                check(corrupted);
+                return duration; });
+    }
+
+    const std::size_t largeAllocations = 16384;
+    for (alloc::Kind kind : kinds)
+    {
+        run(std::string("Alloc large ") + alloc::kindName(kind), largeAllocations, [&, kind](int threadIndex)
+            {
+                std::size_t corrupted = 0;
+                double duration = timeFunction([&]()
+                                               { corrupted = alloc::largeReuse(kind, largeAllocations, uint32_t(threadIndex)); }, 1);
+                check(corrupted);
+                return duration; });
+    }
+}
+
+// Atomics, locks and queues shared by all threads, and false sharing.
+// Threads work on the same objects, so iterations are totals and rates
+// are aggregate; rows that pass something from thread to thread add a
+// latency row (wall time per handoff). Coherency costs depend on how the
+// threads are spread over cores and clusters, so compare thread counts.
+void MathBench::runConcurrencyBenchmark()
+{
+    const int threads = threadCount_;
+
+    // All threads start together and stop the clock together; rank 0 then
+    // checks the result.
+    auto run = [this, threads](const std::string &title, std::size_t total, const std::string &unit,
+                               const std::function<void(int)> &body, const std::function<void()> &check)
+    {
+        Barrier barrier(threads);
+        return executeBenchmark(title, [&](int threadIndex)
+                                {
+                                    barrier.wait();
+                                    double duration = timeFunction([&]()
+                                                                   {
+                                                                       body(threadIndex);
+                                                                       barrier.wait(); }, 1);
+                                    if (threadIndex == 0)
+                                    {
+                                        check();
+                                    }
+                                    return duration; }, total, unit);
+    };
+    // chains: handoffs that proceed in parallel (one per ping-pong pair).
+    auto latency = [this](const std::string &title, const BenchmarkResult &result, int chains)
+    {
+        if (!result.failed)
+        {
+            reportAmount(title + " latency", result, chains / result.opsPerSec, "s");
+        }
+    };
+    auto expect = [](const std::string &what, uint64_t actual, uint64_t expected)
+    {
+        if (actual != expected)
+        {
+            throw std::runtime_error(what + " counted " + std::to_string(actual) + ", expected " +
+                                     std::to_string(expected));
+        }
+    };
+
+    const std::size_t atomicOps = std::size_t(1) << 24;
+    const std::size_t atomicTotal = atomicOps * threads;
+
+    std::atomic<uint64_t> shared{0};
+    run("Atomic fetch_add shared", atomicTotal, "ops", [&](int)
+        {
+            for (std::size_t i = 0; i < atomicOps; ++i)
+            {
+                shared.fetch_add(1, std::memory_order_relaxed);
+            } }, [&]() { expect("fetch_add", shared.load(), atomicTotal); });
+
+    std::vector<conc::Padded<std::atomic<uint64_t>>> own(threads);
+    run("Atomic fetch_add private", atomicTotal, "ops", [&](int threadIndex)
+        {
+            std::atomic<uint64_t> &counter = own[threadIndex].value;
+            for (std::size_t i = 0; i < atomicOps; ++i)
+            {
+                counter.fetch_add(1, std::memory_order_relaxed);
+            } }, [&]()
+        {
+            for (const auto &counter : own)
+            {
+                expect("private fetch_add", counter.value.load(), atomicOps);
+            } });
+
+    std::atomic<uint64_t> casShared{0};
+    run("Atomic CAS loop shared", atomicTotal, "ops", [&](int)
+        {
+            for (std::size_t i = 0; i < atomicOps; ++i)
+            {
+                uint64_t value = casShared.load(std::memory_order_relaxed);
+                while (!casShared.compare_exchange_weak(value, value + 1, std::memory_order_relaxed))
+                {
+                }
+            } }, [&]() { expect("CAS loop", casShared.load(), atomicTotal); });
+
+    // Each thread bumps its own counter with plain load + store (no locked
+    // instruction). Packed, the counters share a line that bounces between
+    // cores on every store; padded, each stays in its owner's cache.
+    std::vector<std::atomic<uint64_t>> packed(threads);
+    run("False sharing packed", atomicTotal, "ops", [&](int threadIndex)
+        {
+            std::atomic<uint64_t> &counter = packed[threadIndex];
+            for (std::size_t i = 0; i < atomicOps; ++i)
+            {
+                counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            } }, [&]()
+        {
+            for (const auto &counter : packed)
+            {
+                expect("packed counter", counter.load(), atomicOps);
+            } });
+
+    std::vector<conc::Padded<std::atomic<uint64_t>>> padded(threads);
+    run("False sharing padded", atomicTotal, "ops", [&](int threadIndex)
+        {
+            std::atomic<uint64_t> &counter = padded[threadIndex].value;
+            for (std::size_t i = 0; i < atomicOps; ++i)
+            {
+                counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            } }, [&]()
+        {
+            for (const auto &counter : padded)
+            {
+                expect("padded counter", counter.value.load(), atomicOps);
+            } });
+
+    // A short critical section (one increment), so the rows measure lock
+    // handoff rather than work under the lock.
+    const std::size_t lockOps = std::size_t(1) << 20;
+    const std::size_t lockTotal = lockOps * threads;
+    auto lockRow = [&](const std::string &name, auto &lock)
+    {
+        uint64_t counter = 0;
+        const std::string title = "Lock " + name;
+        BenchmarkResult result = run(title, lockTotal, "ops", [&](int)
+                                     {
+                                         for (std::size_t i = 0; i < lockOps; ++i)
+                                         {
+                                             std::lock_guard<std::remove_reference_t<decltype(lock)>> guard(lock);
+                                             ++counter;
+                                         } }, [&]() { expect(title, counter, lockTotal); });
+        latency(title, result, 1);
+    };
+    std::mutex mutex;
+    conc::SpinLock spinLock;
+    conc::TicketLock ticketLock;
+    lockRow("std::mutex", mutex);
+    lockRow("spinlock", spinLock);
+    lockRow("ticket", ticketLock);
+
+    // Every thread bounces a counter off an echo thread of its own: two
+    // private SPSC queues per pair, or two MPMC queues shared by all
+    // threads and echo threads. One message in flight per thread, so the
+    // rate is bounded by the round-trip latency.
+    const std::size_t roundTrips = std::size_t(1) << 16;
+    const std::size_t messages = 2 * roundTrips * threads;
+    const uint64_t stop = ~uint64_t(0);
+    auto echo = [stop](auto &ping, auto &pong)
+    {
+        for (uint64_t value = conc::pop<uint64_t>(ping); value != stop; value = conc::pop<uint64_t>(ping))
+        {
+            conc::push(pong, value + 1);
+        }
+    };
+
+    {
+        struct Pair
+        {
+            conc::SpscQueue<uint64_t> ping{64}, pong{64};
+        };
+        std::vector<std::unique_ptr<Pair>> pairs;
+        std::vector<std::thread> echoes;
+        for (int t = 0; t < threads; ++t)
+        {
+            pairs.push_back(std::make_unique<Pair>());
+            echoes.emplace_back([&echo, &pair = *pairs.back()]() { echo(pair.ping, pair.pong); });
+        }
+        std::atomic<uint64_t> mismatches{0};
+        BenchmarkResult result = run("Ping-pong SPSC", messages, "msg", [&](int threadIndex)
+                                     {
+                                         Pair &pair = *pairs[threadIndex];
+                                         for (uint64_t i = 0; i < roundTrips; ++i)
+                                         {
+                                             conc::push(pair.ping, i);
+                                             if (conc::pop<uint64_t>(pair.pong) != i + 1)
+                                             {
+                                                 mismatches.fetch_add(1, std::memory_order_relaxed);
+                                             }
+                                         } }, [&]() { expect("SPSC mismatch", mismatches.load(), 0); });
+        for (int t = 0; t < threads; ++t)
+        {
+            conc::push(pairs[t]->ping, stop);
+            echoes[t].join();
+        }
+        latency("Ping-pong SPSC", result, threads);
+    }
+
+    {
+        // Replies go to whichever thread pops first, so check totals.
+        conc::MpmcQueue<uint64_t> ping(1024), pong(1024);
+        std::vector<std::thread> echoes;
+        for (int t = 0; t < threads; ++t)
+        {
+            echoes.emplace_back([&]() { echo(ping, pong); });
+        }
+        std::atomic<uint64_t> sent{0}, received{0};
+        BenchmarkResult result = run("Ping-pong MPMC", messages, "msg", [&](int)
+                                     {
+                                         uint64_t sum = 0;
+                                         for (uint64_t i = 0; i < roundTrips; ++i)
+                                         {
+                                             conc::push(ping, i);
+                                             sum += conc::pop<uint64_t>(pong);
+                                         }
+                                         sent.fetch_add(roundTrips * (roundTrips - 1) / 2, std::memory_order_relaxed);
+                                         received.fetch_add(sum, std::memory_order_relaxed); }, [&]()
+                                     { expect("MPMC reply sum", received.load(), sent.load() + roundTrips * threads); });
+        for (int t = 0; t < threads; ++t)
+        {
+            conc::push(ping, stop);
+        }
+        for (auto &t : echoes)
+        {
+            t.join();
+        }
+        latency("Ping-pong MPMC", result, threads);
+    }
+}
+
+// File I/O on a scratch file in scratchDirectory_ or the current
+// directory (removed afterwards), through pread/pwrite, mmap and
+// O_DIRECT. All threads share the file: sequential rows split it into one
+// range per thread, random rows split the operations, so rates are
+// aggregate and more threads mean more requests in flight. Reads start from a cold page cache; write rows
+// include the final fdatasync/msync, otherwise they would only measure
+// copies into the cache. Sequential rows report MB/s, random rows IOPS,
+// and both add the 99th percentile of the per-operation latency.
+void MathBench::runStorageBenchmark()
+{
+    const int threads = threadCount_;
+    const std::size_t maxFileBytes = std::size_t(64) << 20;
+
+    std::unique_ptr<storage::ScratchFile> file;
+    try
+    {
+        file.reset(new storage::ScratchFile(scratchDirectory_.empty() ? "." : scratchDirectory_, maxFileBytes));
+    }
+    catch (const std::exception &e)
+    {
+        const std::string reason = e.what();
+        executeBenchmark("IO scratch file", [reason](int) -> double
+                         { throw std::runtime_error(reason); }, 1);
+        return;
+    }
+
+    // Errors are held until every thread has passed both barriers, so a
+    // failing thread cannot leave the others waiting.
+    std::vector<std::vector<double>> latencies(threads);
+    auto run = [&](const std::string &title, std::size_t iterations, const std::string &unit,
+                   const std::function<void(int)> &body, const std::function<void()> &finish)
+    {
+        for (auto &samples : latencies)
+        {
+            samples.clear();
+        }
+        Barrier barrier(threads);
+        BenchmarkResult result = executeBenchmark(title, [&](int threadIndex)
+                                                  {
+                                                      std::exception_ptr error;
+                                                      barrier.wait();
+                                                      double duration = timeFunction([&]()
+                                                                                     {
+                                                                                         try
+                                                                                         {
+                                                                                             body(threadIndex);
+                                                                                         }
+                                                                                         catch (...)
+                                                                                         {
+                                                                                             error = std::current_exception();
+                                                                                         }
+                                                                                         barrier.wait();
+                                                                                         if (threadIndex == 0 && !error)
+                                                                                         {
+                                                                                             try
+                                                                                             {
+                                                                                                 finish();
+                                                                                             }
+                                                                                             catch (...)
+                                                                                             {
+                                                                                                 error = std::current_exception();
+                                                                                             }
+                                                                                         }
+                                                                                         barrier.wait(); }, 1);
+                                                      if (error)
+                                                      {
+                                                          std::rethrow_exception(error);
+                                                      }
+                                                      return duration; }, iterations, unit);
+        if (!result.failed)
+        {
+            std::vector<double> all;
+            for (const auto &samples : latencies)
+            {
+                all.insert(all.end(), samples.begin(), samples.end());
+            }
+            reportAmount(title + " p99", result, storage::percentile(all, 0.99), "s");
+        }
+        return result;
+    };
+
+    std::vector<storage::Method> methods = {storage::Method::Buffered, storage::Method::Mmap};
+    if (file->directFd() >= 0)
+    {
+        methods.push_back(storage::Method::Direct);
+    }
+    auto blockName = [](std::size_t block)
+    {
+        return block >= (1u << 20) ? std::to_string(block >> 20) + "M" : std::to_string(block >> 10) + "K";
+    };
+    auto access = [&](storage::Method method, bool write, bool random, std::size_t block, std::size_t ops)
+    {
+        const storage::Request request{method, write, random, block};
+        const std::string title = std::string("IO ") + (random ? "rnd " : "seq ") + (write ? "wr " : "rd ") +
+                                  storage::methodName(method) + " " + blockName(block);
+        if (!write)
+        {
+            file->dropCache();
+        }
+        run(title, random ? ops : ops * block, random ? "IO" : "B", [&](int threadIndex)
+                                     {
+                                         const std::size_t first = ops * threadIndex / threads;
+                                         const std::size_t count = ops * (threadIndex + 1) / threads - first;
+                                         storage::run(*file, request, first, count, uint32_t(threadIndex + 1),
+                                                      latencies[threadIndex]); }, [&]()
+                                     {
+                                         if (write)
+                                         {
+                                             file->sync(method);
+                                         }
+                                     });
+    };
+
+    // Sequential passes cover the whole file; 4 KB shows per-call
+    // overhead, 1 MB the bandwidth of the device.
+    for (bool write : {false, true})
+    {
+        for (std::size_t block : {std::size_t(4) << 10, std::size_t(1) << 20})
+        {
+            for (storage::Method method : methods)
+            {
+                access(method, write, false, block, file->size() / block);
+            }
+        }
+    }
+
+    for (bool write : {false, true})
+    {
+        for (std::size_t block : {std::size_t(4) << 10, std::size_t(64) << 10})
+        {
+            for (storage::Method method : methods)
+            {
+                access(method, write, true, block, block > (4u << 10) ? 512 : 2048);
+            }
+        }
+    }
+
+    // Durable small writes, as a database commit or log append does them.
+    const std::size_t syncOps = 256;
+    for (bool dataOnly : {false, true})
+    {
+        run(dataOnly ? "IO fdatasync 4K" : "IO fsync 4K", syncOps, "ops", [&](int threadIndex)
+            {
+                const std::size_t first = syncOps * threadIndex / threads;
+                const std::size_t count = syncOps * (threadIndex + 1) / threads - first;
+                storage::runSynced(*file, dataOnly, first, count, latencies[threadIndex]); }, []() {});
+    }
+}
+
+namespace
+{
+
+// Plain table version an algorithm is checked against (itself for
+// those without a faster variant).
+checksum::Algorithm checksumReference(checksum::Algorithm algorithm)
+{
+    using checksum::Algorithm;
+    switch (algorithm)
+    {
+    case Algorithm::Crc32Slice8:
+    case Algorithm::Crc32Slice16:
+    case Algorithm::Crc32Fold:
+    case Algorithm::Crc32Instruction:
+        return Algorithm::Crc32Bytewise;
+    case Algorithm::Crc32cInstruction:
+        return Algorithm::Crc32cSlice8;
+    default:
+        return algorithm;
+    }
+}
+
+// Check values from the CRC catalogue ("123456789"), RFC 1950 examples and
+// the reference xxHash implementation, plus a 100-byte message that goes
+// through the stripe loops, the folding path and the tails.
+void checkChecksumKnownAnswers(checksum::Algorithm algorithm)
+{
+    using checksum::Algorithm;
+    struct Answer
+    {
+        Algorithm family;
+        const char *text; // nullptr: the 100-byte message
+        uint64_t value;
+    };
+    static const Answer answers[] = {
+        {Algorithm::Crc32Bytewise, "123456789", 0xCBF43926},
+        {Algorithm::Crc32Bytewise, nullptr, 0xAA316B09},
+        {Algorithm::Crc32cSlice8, "123456789", 0xE3069283},
+        {Algorithm::Crc32cSlice8, nullptr, 0x594B1B65},
+        {Algorithm::Adler32, "Wikipedia", 0x11E60398},
+        {Algorithm::Adler32, nullptr, 0xAEE02E87},
+        {Algorithm::Xxh32, "", 0x02CC5D05},
+        {Algorithm::Xxh32, "abc", 0x32D153FF},
+        {Algorithm::Xxh32, nullptr, 0x73091A4D},
+        {Algorithm::Xxh64, "", 0xEF46DB3751D8E999},
+        {Algorithm::Xxh64, "abc", 0x44BC2CF5AD770999},
+        {Algorithm::Xxh64, nullptr, 0xA61F8D4C170FE531},
+    };
+
+    uint8_t message[100];
+    for (int i = 0; i < 100; ++i)
+    {
+        message[i] = static_cast<uint8_t>(i * 7 + 3);
+    }
+    const Algorithm family = checksumReference(algorithm);
+    for (const Answer &answer : answers)
+    {
+        if (answer.family != family)
+        {
+            continue;
+        }
+        const uint8_t *data = answer.text ? reinterpret_cast<const uint8_t *>(answer.text) : message;
+        const std::size_t len = answer.text ? std::strlen(answer.text) : sizeof(message);
+        if (checksum::compute(algorithm, data, len) != answer.value)
+        {
+            throw std::runtime_error(std::string("Known-answer test failed for ") + checksum::algorithmName(algorithm));
+        }
+    }
+}
+
+} // namespace
+
+// Checksum throughput in MB/s per thread for CRC-32 (byte table,
+// slicing-by-8/16, carry-less multiply folding, ARMv8 instructions),
+// CRC-32C (tables vs SSE4.2 / ARMv8 instructions), Adler-32 and xxHash.
+// Rows the CPU cannot run are left out. Every row first passes the known
+// answers, and the fast CRC paths must match their table version on the
+// row's own buffer. Small buffers show setup and tail costs; 1 MB ones
+// the streaming rate, which for the instruction paths is bound by the
+// latency of one dependent CRC step per 8 bytes.
+void MathBench::runChecksumBenchmark()
+{
+    using checksum::Algorithm;
+    struct Size
+    {
+        std::size_t bytes;
+        const char *label;
+    };
+    const Size sizes[] = {{64, "64B"}, {4 * 1024, "4K"}, {1024 * 1024, "1M"}};
+    const std::size_t bytesPerRow = 128 * 1024 * 1024;
+
+    for (Algorithm algorithm : {Algorithm::Crc32Bytewise, Algorithm::Crc32Slice8, Algorithm::Crc32Slice16,
+                                Algorithm::Crc32Fold, Algorithm::Crc32Instruction, Algorithm::Crc32cSlice8,
+                                Algorithm::Crc32cInstruction, Algorithm::Adler32, Algorithm::Xxh32, Algorithm::Xxh64})
+    {
+        if (!checksum::available(algorithm))
+        {
+            continue;
+        }
+
+        for (const Size &size : sizes)
+        {
+            const std::size_t passes = bytesPerRow / size.bytes;
+            const std::string title = std::string(checksum::algorithmName(algorithm)) + " " + size.label;
+            const Algorithm expected = checksumReference(algorithm);
+
+            executeBenchmark(title, [this, algorithm, expected, size, passes](int)
+                             {
+                                 checkChecksumKnownAnswers(algorithm);
+
+                                 std::random_device rd;
+                                 std::mt19937 localEngine(rd());
+                                 std::uniform_int_distribution<int> byteDist(0, 255);
+                                 std::vector<uint8_t> data(size.bytes);
+                                 for (auto &b : data)
+                                 {
+                                     b = static_cast<uint8_t>(byteDist(localEngine));
+                                 }
+
+                                 if (expected != algorithm &&
+                                     checksum::compute(algorithm, data.data(), data.size()) !=
+                                         checksum::compute(expected, data.data(), data.size()))
+                                 {
+                                     throw std::runtime_error(std::string(checksum::algorithmName(algorithm)) +
+                                                              " differs from " + checksum::algorithmName(expected));
+                                 }
+
+                                 uint64_t chain = 0;
+                                 double duration = timeFunction([&]()
+                                                                {
+                                     chain += checksum::compute(algorithm, data.data(), data.size());
+                                     data[0] ^= static_cast<uint8_t>(chain); // Chain iterations together
+                                 }, passes);
+
+                                 return duration; }, passes * size.bytes, "B");
+        }
+    }
+}
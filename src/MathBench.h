@@ -35,13 +35,21 @@ public:
 private:
     int threadCount_{1};
     std::unique_ptr<UI> ui_;
-    //std::string selectedBenchmark_{"all"};
+    // Comma-separated benchmark groups to run ("all", "core", "bigint", "aes", "nbody",
+    // "stats", "transform", "complex", "spmv", "alloc", "sync", "io", "checksum").
+    std::string selectedBenchmark_{"all"};
+    // Directory for the storage benchmark's scratch file (third argument).
+    // Empty means the current directory, and leaves "io" out of "all".
+    std::string scratchDirectory_;
 
     // Helper to build per-thread RNGs with different seeds.
     std::random_device rd_;
 
     // Parse command line arguments (e.g., which benchmark to run, thread count, etc.).
     void parseArguments(int argc, char** argv);
+    // True when the group was named on the command line (or "all" was;
+    // "io" only counts as part of "all" when a scratch directory is given).
+    bool isSelected(const std::string& group) const;
 	// Example benchmark hooks — you can change/extend these as you like.
 	void runAllBenchmarks();
 	void runBasicArithmeticBenchmark();
@@ -56,25 +64,50 @@ private:
     void runFibonacciBenchmark();
     void runMonteCarloPiBenchmark();
     void runFourierTransformBenchmark();
+    void runBigIntegerBenchmark();
+    void runAesEncryptionBenchmark();
+    void runDifferentialEquationBenchmark();
+    void runStatisticalComputationBenchmark();
+    void run3DTransformationBenchmark();
+    void runComplexNumberBenchmark();
+    void runSparseMatrixVectorBenchmark();
+    void runAllocatorStressBenchmark();
+    void runConcurrencyBenchmark();
+    void runStorageBenchmark();
+    void runChecksumBenchmark();
 
     /*
 
     
     void runRandomNumberGenerationBenchmark();
-    void runStatisticalComputationBenchmark();
-    void runComplexNumberBenchmark();
     void runVectorOperationsBenchmark();
-    void runDifferentialEquationBenchmark();
-    void runBigIntegerBenchmark();
-    void runAesEncryptionBenchmark();
     void runBaseConversionBenchmark();
     void runDateTimeComputationBenchmark();
     void runGeometryComputationBenchmark();
-    void run3DTransformationBenchmark();
-    void runImaginaryNumberBenchmark();
     */
 
-    void executeBenchmark(const std::string& title, const std::function<double(int)>& worker, std::size_t iterations);
+    // Big-integer rows for one limb width; suffix names the limb type.
+    template <typename Limb>
+    void runBigIntegerSuite(const std::string& suffix);
+
+    // Runs worker(threadIndex) on every thread. A worker that throws marks
+    // the benchmark as failed instead of taking the process down.
+    // iterations counts work units of the given unit ("ops", "B", ...)
+    // done by each thread, or the shared total when the threads split one
+    // job (the rate is then aggregate); the rate shown is iterations /
+    // average time.
+    BenchmarkResult executeBenchmark(const std::string& title, const std::function<double(int)>& worker,
+                                     std::size_t iterations, const std::string& unit = "ops");
+
+    // Adds a row reusing another row's timings with a different work
+    // count, e.g. bytes moved next to FLOPs, without running it again.
+    void reportDerivedRate(const std::string& title, const BenchmarkResult& source, double iterations,
+                           const std::string& unit);
+
+    // Adds a row next to another one showing a plain amount instead of a
+    // rate, e.g. the peak memory it used.
+    void reportAmount(const std::string& title, const BenchmarkResult& source, double amount,
+                      const std::string& unit);
 
     // Helper to measure how long a function takes.
     template <typename F>
@@ -0,0 +1,344 @@
+// NBody.cpp
+// RK4 integrator and O(N^2) gravitational force kernels in AoS, SoA and
+// SIMD SoA form.
+
+#include "NBody.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "CpuFeatures.h"
+#include "Simd.h"
+
+namespace nbody {
+
+namespace {
+
+// Ranges are split on multiples of the widest vector, so every thread
+// gets whole vectors whichever variant runs.
+constexpr std::size_t kWidth = simd::kMaxWidth;
+
+// Plummer softening keeps close encounters finite.
+constexpr float kSoftening = 0.05f;
+
+// One vector of target bodies, sources broadcast one at a time. Each lane
+// keeps its own sum, so no reassociation (-ffast-math) is needed for the
+// compiler to use SIMD.
+template <typename V>
+SIMD_INLINE void forcesVector(const float *px, const float *py, const float *pz, const float *mass, std::size_t n,
+                              float *ax, float *ay, float *az, std::size_t begin, std::size_t end)
+{
+    const float eps2 = kSoftening * kSoftening;
+    for (std::size_t i = begin; i < end; i += simd::lanes<V>())
+    {
+        const V xi = simd::load<V>(px + i), yi = simd::load<V>(py + i), zi = simd::load<V>(pz + i);
+        V sx = {}, sy = {}, sz = {};
+        for (std::size_t j = 0; j < n; ++j)
+        {
+            V dx = px[j] - xi;
+            V dy = py[j] - yi;
+            V dz = pz[j] - zi;
+            V inv = simd::rsqrt(dx * dx + dy * dy + dz * dz + eps2);
+            V s = mass[j] * inv * inv * inv;
+            sx += dx * s;
+            sy += dy * s;
+            sz += dz * s;
+        }
+        simd::store(ax + i, sx);
+        simd::store(ay + i, sy);
+        simd::store(az + i, sz);
+    }
+}
+
+void forcesBaseline(const float *px, const float *py, const float *pz, const float *mass, std::size_t n, float *ax,
+                    float *ay, float *az, std::size_t begin, std::size_t end)
+{
+    forcesVector<simd::Vec4>(px, py, pz, mass, n, ax, ay, az, begin, end);
+}
+
+#if defined(SIMD_AVX2_VARIANT)
+SIMD_AVX2_TARGET
+void forcesAvx2(const float *px, const float *py, const float *pz, const float *mass, std::size_t n, float *ax,
+                float *ay, float *az, std::size_t begin, std::size_t end)
+{
+    forcesVector<simd::Vec8>(px, py, pz, mass, n, ax, ay, az, begin, end);
+}
+#elif defined(SIMD_NEON_VARIANT)
+SIMD_NEON_TARGET
+void forcesNeon(const float *px, const float *py, const float *pz, const float *mass, std::size_t n, float *ax,
+                float *ay, float *az, std::size_t begin, std::size_t end)
+{
+    forcesVector<simd::Vec4>(px, py, pz, mass, n, ax, ay, az, begin, end);
+}
+#endif
+
+} // namespace
+
+std::string kernelName(Kernel kernel)
+{
+    switch (kernel)
+    {
+    case Kernel::AoS:
+        return "AoS";
+    case Kernel::SoA:
+        return "SoA";
+    case Kernel::SoAVector:
+        return std::string("SoA ") + cpu::simdLevelName(cpu::simdLevel());
+    }
+    return "unknown";
+}
+
+Simulation::Simulation(Kernel kernel, std::size_t n, float dt, uint32_t seed)
+    : kernel_(kernel), n_(n), padded_((n + kWidth - 1) / kWidth * kWidth), dt_(dt)
+{
+    for (int d = 0; d < 3; ++d)
+    {
+        pos_[d].assign(padded_, 0.0f);
+        vel_[d].assign(padded_, 0.0f);
+        kx_[d].assign(padded_, 0.0f);
+        kv_[d].assign(padded_, 0.0f);
+        sumX_[d].assign(padded_, 0.0f);
+        sumV_[d].assign(padded_, 0.0f);
+    }
+    // Padding bodies have zero mass, so they never pull on anything.
+    mass_.assign(padded_, 0.0f);
+    px_.assign(padded_, 0.0f);
+    py_.assign(padded_, 0.0f);
+    pz_.assign(padded_, 0.0f);
+    ax_.assign(padded_, 0.0f);
+    ay_.assign(padded_, 0.0f);
+    az_.assign(padded_, 0.0f);
+    bodies_.assign(kernel == Kernel::AoS ? padded_ : 0, Body{});
+
+    std::mt19937 engine(seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (std::size_t i = 0; i < n_; ++i)
+    {
+        float x, y, z;
+        do
+        {
+            x = unit(engine);
+            y = unit(engine);
+            z = unit(engine);
+        } while (x * x + y * y + z * z > 1.0f);
+
+        pos_[0][i] = x;
+        pos_[1][i] = y;
+        pos_[2][i] = z;
+        for (int d = 0; d < 3; ++d)
+        {
+            vel_[d][i] = 0.1f * unit(engine);
+        }
+        mass_[i] = 1.0f / float(n_);
+        if (kernel_ == Kernel::AoS)
+        {
+            bodies_[i].mass = mass_[i];
+        }
+    }
+}
+
+void Simulation::setStagePosition(std::size_t i, float x, float y, float z)
+{
+    if (kernel_ == Kernel::AoS)
+    {
+        bodies_[i].x = x;
+        bodies_[i].y = y;
+        bodies_[i].z = z;
+    }
+    else
+    {
+        px_[i] = x;
+        py_[i] = y;
+        pz_[i] = z;
+    }
+}
+
+float Simulation::acceleration(int axis, std::size_t i) const
+{
+    if (kernel_ == Kernel::AoS)
+    {
+        const Body &b = bodies_[i];
+        return axis == 0 ? b.ax : (axis == 1 ? b.ay : b.az);
+    }
+    return axis == 0 ? ax_[i] : (axis == 1 ? ay_[i] : az_[i]);
+}
+
+void Simulation::step(int rank, int ranks, Barrier *barrier)
+{
+    const std::size_t vectors = padded_ / kWidth;
+    const std::size_t begin = vectors * rank / ranks * kWidth;
+    const std::size_t end = vectors * (rank + 1) / ranks * kWidth;
+    const std::size_t last = std::min(end, n_);
+
+    auto sync = [barrier]()
+    {
+        if (barrier != nullptr)
+        {
+            barrier->wait();
+        }
+    };
+
+    // Stage s evaluates forces at x + c[s] * dt * kx[s - 1] and uses
+    // velocity kx[s] = v + c[s] * dt * kv[s - 1]; both only need this
+    // body's own data, so only the force pass reads other slices.
+    const float c[4] = {0.0f, 0.5f, 0.5f, 1.0f};
+    const float w[4] = {1.0f, 2.0f, 2.0f, 1.0f};
+
+    for (int s = 0; s < 4; ++s)
+    {
+        const float ch = c[s] * dt_;
+        for (std::size_t i = begin; i < last; ++i)
+        {
+            float p[3];
+            for (int d = 0; d < 3; ++d)
+            {
+                p[d] = pos_[d][i] + ch * kx_[d][i];
+                kx_[d][i] = vel_[d][i] + ch * kv_[d][i];
+                sumX_[d][i] += w[s] * kx_[d][i];
+            }
+            setStagePosition(i, p[0], p[1], p[2]);
+        }
+
+        sync(); // All stage positions written
+        evaluateForces(begin, end);
+        sync(); // Nobody still reads them before the next stage writes
+
+        for (std::size_t i = begin; i < last; ++i)
+        {
+            for (int d = 0; d < 3; ++d)
+            {
+                kv_[d][i] = acceleration(d, i);
+                sumV_[d][i] += w[s] * kv_[d][i];
+            }
+        }
+    }
+
+    const float sixth = dt_ / 6.0f;
+    for (std::size_t i = begin; i < last; ++i)
+    {
+        for (int d = 0; d < 3; ++d)
+        {
+            pos_[d][i] += sixth * sumX_[d][i];
+            vel_[d][i] += sixth * sumV_[d][i];
+            sumX_[d][i] = 0.0f;
+            sumV_[d][i] = 0.0f;
+        }
+    }
+}
+
+void Simulation::evaluateForces(std::size_t begin, std::size_t end)
+{
+    switch (kernel_)
+    {
+    case Kernel::AoS:
+        forcesAoS(begin, std::min(end, n_));
+        break;
+    case Kernel::SoA:
+        forcesSoA(begin, std::min(end, n_));
+        break;
+    case Kernel::SoAVector:
+        forcesSoAVector(begin, end);
+        break;
+    }
+}
+
+void Simulation::forcesAoS(std::size_t begin, std::size_t end)
+{
+    const float eps2 = kSoftening * kSoftening;
+    Body *bodies = bodies_.data();
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        const float xi = bodies[i].x, yi = bodies[i].y, zi = bodies[i].z;
+        float ax = 0.0f, ay = 0.0f, az = 0.0f;
+        for (std::size_t j = 0; j < n_; ++j)
+        {
+            float dx = bodies[j].x - xi;
+            float dy = bodies[j].y - yi;
+            float dz = bodies[j].z - zi;
+            float r2 = dx * dx + dy * dy + dz * dz + eps2;
+            float inv = 1.0f / std::sqrt(r2);
+            float s = bodies[j].mass * inv * inv * inv;
+            ax += dx * s;
+            ay += dy * s;
+            az += dz * s;
+        }
+        bodies[i].ax = ax;
+        bodies[i].ay = ay;
+        bodies[i].az = az;
+    }
+}
+
+void Simulation::forcesSoA(std::size_t begin, std::size_t end)
+{
+    const float eps2 = kSoftening * kSoftening;
+    const float *px = px_.data(), *py = py_.data(), *pz = pz_.data(), *mass = mass_.data();
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        const float xi = px[i], yi = py[i], zi = pz[i];
+        float ax = 0.0f, ay = 0.0f, az = 0.0f;
+        for (std::size_t j = 0; j < n_; ++j)
+        {
+            float dx = px[j] - xi;
+            float dy = py[j] - yi;
+            float dz = pz[j] - zi;
+            float r2 = dx * dx + dy * dy + dz * dz + eps2;
+            float inv = 1.0f / std::sqrt(r2);
+            float s = mass[j] * inv * inv * inv;
+            ax += dx * s;
+            ay += dy * s;
+            az += dz * s;
+        }
+        ax_[i] = ax;
+        ay_[i] = ay;
+        az_[i] = az;
+    }
+}
+
+void Simulation::forcesSoAVector(std::size_t begin, std::size_t end)
+{
+    const float *px = px_.data(), *py = py_.data(), *pz = pz_.data(), *mass = mass_.data();
+    float *ax = ax_.data(), *ay = ay_.data(), *az = az_.data();
+    switch (cpu::simdLevel())
+    {
+#if defined(SIMD_AVX2_VARIANT)
+    case cpu::SimdLevel::Avx2:
+        forcesAvx2(px, py, pz, mass, n_, ax, ay, az, begin, end);
+        break;
+#elif defined(SIMD_NEON_VARIANT)
+    case cpu::SimdLevel::Neon:
+        forcesNeon(px, py, pz, mass, n_, ax, ay, az, begin, end);
+        break;
+#endif
+    default:
+        forcesBaseline(px, py, pz, mass, n_, ax, ay, az, begin, end);
+        break;
+    }
+}
+
+double Simulation::energy() const
+{
+    const double eps2 = double(kSoftening) * kSoftening;
+    double kinetic = 0.0;
+    double potential = 0.0;
+    for (std::size_t i = 0; i < n_; ++i)
+    {
+        double v2 = 0.0;
+        for (int d = 0; d < 3; ++d)
+        {
+            v2 += double(vel_[d][i]) * vel_[d][i];
+        }
+        kinetic += 0.5 * mass_[i] * v2;
+
+        for (std::size_t j = i + 1; j < n_; ++j)
+        {
+            double dx = double(pos_[0][j]) - pos_[0][i];
+            double dy = double(pos_[1][j]) - pos_[1][i];
+            double dz = double(pos_[2][j]) - pos_[2][i];
+            potential -= double(mass_[i]) * mass_[j] / std::sqrt(dx * dx + dy * dy + dz * dz + eps2);
+        }
+    }
+    return kinetic + potential;
+}
+
+} // namespace nbody
@@ -0,0 +1,77 @@
+// NBody.h
+// Gravitational N-body system integrated with classic RK4, used by the
+// differential-equation benchmark.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Barrier.h"
+
+namespace nbody {
+
+enum class Kernel {
+    AoS,      // Scalar force loop over an array of particle records
+    SoA,      // Scalar force loop over separate x/y/z/mass arrays
+    SoAVector // SoA with one SIMD vector of target bodies at a time
+};
+
+// "AoS", "SoA", or "SoA" plus the SIMD level in use (e.g. "SoA AVX2").
+std::string kernelName(Kernel kernel);
+
+// A particle record as naive simulation code would store it. Only the
+// AoS kernel uses it; the force loop strides over the whole record.
+struct Body {
+    float x, y, z;
+    float vx, vy, vz;
+    float ax, ay, az;
+    float mass;
+};
+
+class Simulation {
+public:
+    // n bodies uniformly in the unit sphere, total mass 1, G = 1.
+    Simulation(Kernel kernel, std::size_t n, float dt, uint32_t seed);
+
+    std::size_t size() const { return n_; }
+
+    // Pairwise interactions evaluated per step (four force passes).
+    double interactionsPerStep() const { return 4.0 * double(n_) * double(n_); }
+
+    // Advances one RK4 step. Threads sharing a simulation all call step()
+    // with their own rank and the same barrier; each integrates and
+    // evaluates forces for 1/ranks of the bodies.
+    void step(int rank = 0, int ranks = 1, Barrier *barrier = nullptr);
+
+    // Kinetic plus softened potential energy in double precision, O(N^2).
+    double energy() const;
+
+private:
+    void setStagePosition(std::size_t i, float x, float y, float z);
+    void evaluateForces(std::size_t begin, std::size_t end);
+    void forcesAoS(std::size_t begin, std::size_t end);
+    void forcesSoA(std::size_t begin, std::size_t end);
+    void forcesSoAVector(std::size_t begin, std::size_t end);
+    float acceleration(int axis, std::size_t i) const;
+
+    Kernel kernel_;
+    std::size_t n_;
+    std::size_t padded_; // n rounded up to the widest vector
+    float dt_;
+
+    // Integrator state is always SoA; integration is O(N) next to the
+    // O(N^2) force pass, which is what the layouts are compared on.
+    std::vector<float> pos_[3], vel_[3];
+    std::vector<float> kx_[3], kv_[3]; // Previous stage derivatives
+    std::vector<float> sumX_[3], sumV_[3];
+
+    // Force-kernel inputs/outputs in the layout under test.
+    std::vector<Body> bodies_;
+    std::vector<float> px_, py_, pz_, mass_;
+    std::vector<float> ax_, ay_, az_;
+};
+
+} // namespace nbody
@@ -0,0 +1,247 @@
+// Sha256.cpp
+// Message padding and the SHA-NI / ARMv8 SHA2 compression functions; the
+// portable backend is picosha2.
+
+#include "Sha256.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "../external/picosha2.h"
+#include "CpuFeatures.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SHA256_HW_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define SHA256_HW_ARM 1
+#endif
+
+namespace sha256 {
+
+namespace {
+
+constexpr std::size_t kBlockBytes = 64;
+
+#if defined(SHA256_HW_X86) || defined(SHA256_HW_ARM)
+
+const uint32_t kInitialState[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                   0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+const uint32_t kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+#endif
+
+// ---------------------------------------------------------------------------
+// Compression functions: fold `blocks` 64-byte blocks into state. Both
+// run the 64 rounds as 16 groups of four, keeping the message schedule
+// in four vector registers w[g % 4].
+
+#if defined(SHA256_HW_X86)
+
+bool hardwareSupported()
+{
+    return cpu::features().sha && cpu::features().sse42;
+}
+
+const char *hardwareLabel() { return "SHA-NI"; }
+
+// SHA256RNDS2 works on the state as ABEF / CDGH halves and does two rounds
+// per instruction, taking the round inputs from the low 64 bits.
+__attribute__((target("sha,sse4.1")))
+void compressHardware(uint32_t state[8], const uint8_t *data, std::size_t blocks)
+{
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bll, 0x0405060700010203ll);
+
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state)), 0xB1); // CDAB
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state + 4)), 0x1B); // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);    // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);         // CDGH
+
+    for (; blocks > 0; --blocks, data += kBlockBytes)
+    {
+        const __m128i abefSave = state0;
+        const __m128i cdghSave = state1;
+        __m128i w[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            w[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16 * i)), byteSwap);
+        }
+
+#pragma GCC unroll 16
+        for (int g = 0; g < 16; ++g)
+        {
+            __m128i msg = _mm_add_epi32(w[g % 4],
+                                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(kRoundConstants + 4 * g)));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            if (g >= 3 && g < 15)
+            {
+                // Finish the schedule words for group g + 1.
+                __m128i &next = w[(g + 1) % 4];
+                next = _mm_add_epi32(next, _mm_alignr_epi8(w[g % 4], w[(g + 3) % 4], 4));
+                next = _mm_sha256msg2_epu32(next, w[g % 4]);
+            }
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+            if (g >= 1 && g < 13)
+            {
+                // Start the schedule words for group g + 3.
+                w[(g + 3) % 4] = _mm_sha256msg1_epu32(w[(g + 3) % 4], w[g % 4]);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);        // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);     // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);  // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);     // ABEF
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state + 4), state1);
+}
+
+#elif defined(SHA256_HW_ARM)
+
+bool hardwareSupported()
+{
+    return cpu::features().sha;
+}
+
+const char *hardwareLabel() { return "ARMv8-SHA2"; }
+
+// SHA256H / SHA256H2 do four rounds on the ABCD / EFGH halves; SU0 / SU1
+// extend the schedule by four words.
+__attribute__((target("+crypto")))
+void compressHardware(uint32_t state[8], const uint8_t *data, std::size_t blocks)
+{
+    uint32x4_t state0 = vld1q_u32(state);
+    uint32x4_t state1 = vld1q_u32(state + 4);
+
+    for (; blocks > 0; --blocks, data += kBlockBytes)
+    {
+        const uint32x4_t abcdSave = state0;
+        const uint32x4_t efghSave = state1;
+        uint32x4_t w[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+        }
+
+#pragma GCC unroll 16
+        for (int g = 0; g < 16; ++g)
+        {
+            const uint32x4_t msg = vaddq_u32(w[g % 4], vld1q_u32(kRoundConstants + 4 * g));
+            if (g < 12)
+            {
+                w[g % 4] = vsha256su0q_u32(w[g % 4], w[(g + 1) % 4]);
+            }
+            const uint32x4_t abcd = state0;
+            state0 = vsha256hq_u32(state0, state1, msg);
+            state1 = vsha256h2q_u32(state1, abcd, msg);
+            if (g < 12)
+            {
+                w[g % 4] = vsha256su1q_u32(w[g % 4], w[(g + 2) % 4], w[(g + 3) % 4]);
+            }
+        }
+
+        state0 = vaddq_u32(state0, abcdSave);
+        state1 = vaddq_u32(state1, efghSave);
+    }
+
+    vst1q_u32(state, state0);
+    vst1q_u32(state + 4, state1);
+}
+
+#else
+
+bool hardwareSupported() { return false; }
+
+const char *hardwareLabel() { return "hardware"; }
+
+#endif
+
+#if defined(SHA256_HW_X86) || defined(SHA256_HW_ARM)
+
+// FIPS 180-4 padding: a 1 bit, zeros, and the bit length as a 64-bit
+// big-endian number, filling one or two final blocks.
+void hashHardware(const uint8_t *data, std::size_t len, uint8_t digest[kDigestBytes])
+{
+    uint32_t state[8];
+    std::memcpy(state, kInitialState, sizeof(state));
+
+    const std::size_t full = len / kBlockBytes;
+    compressHardware(state, data, full);
+
+    uint8_t tail[2 * kBlockBytes] = {};
+    const std::size_t rest = len - full * kBlockBytes;
+    std::memcpy(tail, data + full * kBlockBytes, rest);
+    tail[rest] = 0x80;
+    const std::size_t tailBlocks = rest + 9 <= kBlockBytes ? 1 : 2;
+    const uint64_t bits = uint64_t(len) * 8;
+    for (int i = 0; i < 8; ++i)
+    {
+        tail[tailBlocks * kBlockBytes - 1 - i] = uint8_t(bits >> (8 * i));
+    }
+    compressHardware(state, tail, tailBlocks);
+
+    for (int i = 0; i < 8; ++i)
+    {
+        digest[4 * i] = uint8_t(state[i] >> 24);
+        digest[4 * i + 1] = uint8_t(state[i] >> 16);
+        digest[4 * i + 2] = uint8_t(state[i] >> 8);
+        digest[4 * i + 3] = uint8_t(state[i]);
+    }
+}
+
+#endif
+
+} // namespace
+
+const char *backendName(Backend backend)
+{
+    return backend == Backend::Hardware ? hardwareLabel() : "picosha2";
+}
+
+bool available(Backend backend)
+{
+    if (backend == Backend::Hardware)
+    {
+        static const bool supported = hardwareSupported();
+        return supported;
+    }
+    return true;
+}
+
+Backend best()
+{
+    return available(Backend::Hardware) ? Backend::Hardware : Backend::Portable;
+}
+
+void hash(Backend backend, const uint8_t *data, std::size_t len, uint8_t digest[kDigestBytes])
+{
+    if (!available(backend))
+    {
+        throw std::runtime_error("SHA-256 backend not supported on this CPU");
+    }
+#if defined(SHA256_HW_X86) || defined(SHA256_HW_ARM)
+    if (backend == Backend::Hardware)
+    {
+        hashHardware(data, len, digest);
+        return;
+    }
+#endif
+    picosha2::hash256(data, data + len, digest, digest + kDigestBytes);
+}
+
+} // namespace sha256
@@ -0,0 +1,30 @@
+// Sha256.h
+// SHA-256 through picosha2 or the CPU's SHA instructions, used by the
+// SHA-256 hashing benchmark.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sha256 {
+
+constexpr std::size_t kDigestBytes = 32;
+
+enum class Backend {
+    Portable, // picosha2
+    Hardware  // SHA-NI on x86-64, ARMv8 SHA2 on AArch64
+};
+
+// Short name for reports: "picosha2", "SHA-NI", "ARMv8-SHA2".
+const char *backendName(Backend backend);
+
+// Whether this build and the CPU it runs on support the backend.
+bool available(Backend backend);
+
+// Hardware where available, else Portable.
+Backend best();
+
+void hash(Backend backend, const uint8_t *data, std::size_t len, uint8_t digest[kDigestBytes]);
+
+} // namespace sha256
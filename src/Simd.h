@@ -0,0 +1,88 @@
+// Simd.h
+// Portable float vectors on top of GCC vector extensions, shared by the
+// hand-vectorised benchmark kernels.
+//
+// Kernels are written once as templates over the vector type and then
+// instantiated in functions compiled for different instruction sets (see
+// SimdLevel in CpuFeatures.h). The helpers are always_inline so they pick
+// up the instruction set of whichever variant they end up in.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace simd {
+
+// SSE on x86, NEON on ARMv7/AArch64, plain scalar code on targets
+// without a vector unit (ARMv6, RV64GC).
+typedef float Vec4 __attribute__((vector_size(16)));
+// Lane masks from Vec4 comparisons, and __builtin_shuffle indices.
+typedef int32_t Vec4i __attribute__((vector_size(16)));
+// Eight lanes for the AVX2 variants. Only use it inside SIMD_AVX2_TARGET
+// functions; elsewhere GCC splits it into two halves.
+typedef float Vec8 __attribute__((vector_size(32)));
+
+constexpr std::size_t kWidth = 4;
+// Widest vector any variant uses; data is padded to a multiple of it.
+constexpr std::size_t kMaxWidth = 8;
+
+#define SIMD_INLINE inline __attribute__((always_inline))
+
+// Extra variants: x86-64 builds without -mavx2 get an AVX2 version of each
+// kernel, 32-bit ARM builds without NEON (armv6) get a NEON version. NEON
+// needs ARMv7-A, so the variant raises the architecture as well; it only
+// runs on CPUs reporting NEON, which are all ARMv7 or later.
+#if defined(__x86_64__) && !defined(__AVX2__)
+#define SIMD_AVX2_VARIANT 1
+#define SIMD_AVX2_TARGET __attribute__((target("avx2,fma")))
+#elif defined(__arm__) && !defined(__ARM_NEON)
+#define SIMD_NEON_VARIANT 1
+#define SIMD_NEON_TARGET __attribute__((target("arch=armv7-a,fpu=neon")))
+#endif
+
+template <typename V>
+constexpr std::size_t lanes()
+{
+    return sizeof(V) / sizeof(float);
+}
+
+// Unaligned load/store; compiles to a single vector move.
+template <typename V>
+SIMD_INLINE V load(const float *p)
+{
+    V v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+template <typename V>
+SIMD_INLINE void store(float *p, V v)
+{
+    std::memcpy(p, &v, sizeof(v));
+}
+
+// 1/sqrt(x) from the classic bit-level estimate (3.4% error) plus three
+// Newton steps, which brings it within a few ulp of the exact value.
+// Plain arithmetic, so it vectorises on every instruction set (and
+// rsqrt(0) stays finite).
+template <typename V>
+SIMD_INLINE V rsqrt(V x)
+{
+    typedef decltype(x < x) Mask;
+    V y = (V)(0x5f375a86 - ((Mask)x >> 1));
+    const V half = 0.5f * x;
+    y = y * (1.5f - half * y * y);
+    y = y * (1.5f - half * y * y);
+    y = y * (1.5f - half * y * y);
+    return y;
+}
+
+template <typename V>
+SIMD_INLINE V sqrt(V x)
+{
+    return x * rsqrt(x);
+}
+
+} // namespace simd
@@ -0,0 +1,272 @@
+// Sparse.cpp
+// CSR/ELL/SELL-C-sigma construction, SpMV kernels and matrix generators.
+
+#include "Sparse.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+namespace sparse {
+
+namespace {
+
+// Builds a CSR matrix from per-row column lists (sorted and deduplicated
+// here) with random values.
+Csr assemble(std::size_t rows, std::vector<std::vector<uint32_t>> &columns, std::mt19937 &engine)
+{
+    std::uniform_real_distribution<double> value(-1.0, 1.0);
+    Csr csr;
+    csr.rows = rows;
+    csr.cols = rows;
+    csr.rowPtr.reserve(rows + 1);
+    csr.rowPtr.push_back(0);
+    for (auto &row : columns)
+    {
+        std::sort(row.begin(), row.end());
+        row.erase(std::unique(row.begin(), row.end()), row.end());
+        for (uint32_t c : row)
+        {
+            csr.colIdx.push_back(c);
+            csr.values.push_back(value(engine));
+        }
+        csr.rowPtr.push_back(uint32_t(csr.colIdx.size()));
+        std::vector<uint32_t>().swap(row);
+    }
+    return csr;
+}
+
+} // namespace
+
+void Csr::multiply(const double *x, double *y, std::size_t rowBegin, std::size_t rowEnd) const
+{
+    const uint32_t *ptr = rowPtr.data();
+    const uint32_t *col = colIdx.data();
+    const double *val = values.data();
+    for (std::size_t r = rowBegin; r < rowEnd; ++r)
+    {
+        double sum = 0.0;
+        for (uint32_t k = ptr[r]; k < ptr[r + 1]; ++k)
+        {
+            sum += val[k] * x[col[k]];
+        }
+        y[r] = sum;
+    }
+}
+
+double Csr::bytes() const
+{
+    return double(nnz()) * (sizeof(double) + sizeof(uint32_t)) + double(rows + 1) * sizeof(uint32_t) +
+           double(cols + rows) * sizeof(double);
+}
+
+Csr banded(std::size_t rows, std::size_t halfWidth, uint32_t seed)
+{
+    std::mt19937 engine(seed);
+    std::vector<std::vector<uint32_t>> columns(rows);
+    for (std::size_t r = 0; r < rows; ++r)
+    {
+        std::size_t first = r > halfWidth ? r - halfWidth : 0;
+        std::size_t last = std::min(rows - 1, r + halfWidth);
+        for (std::size_t c = first; c <= last; ++c)
+        {
+            columns[r].push_back(uint32_t(c));
+        }
+    }
+    return assemble(rows, columns, engine);
+}
+
+Csr randomUniform(std::size_t rows, std::size_t perRow, uint32_t seed)
+{
+    std::mt19937 engine(seed);
+    std::uniform_int_distribution<uint32_t> column(0, uint32_t(rows - 1));
+    std::vector<std::vector<uint32_t>> columns(rows);
+    for (auto &row : columns)
+    {
+        for (std::size_t k = 0; k < perRow; ++k)
+        {
+            row.push_back(column(engine));
+        }
+    }
+    return assemble(rows, columns, engine);
+}
+
+Csr powerLaw(std::size_t rows, std::size_t meanPerRow, std::size_t maxPerRow, uint32_t seed)
+{
+    // Density ~ length^-2.5, i.e. Pareto with shape 1.5 (finite mean of
+    // 3 * minimum, infinite variance).
+    const double densityExponent = 2.5;
+    const double minimum = double(meanPerRow) * (densityExponent - 2.0) / (densityExponent - 1.0);
+
+    std::mt19937 engine(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_int_distribution<uint32_t> column(0, uint32_t(rows - 1));
+    std::vector<std::vector<uint32_t>> columns(rows);
+    for (auto &row : columns)
+    {
+        double length = minimum * std::pow(1.0 - unit(engine), -1.0 / (densityExponent - 1.0));
+        std::size_t count = std::min(maxPerRow, std::size_t(length));
+        for (std::size_t k = 0; k < count; ++k)
+        {
+            row.push_back(column(engine));
+        }
+    }
+    return assemble(rows, columns, engine);
+}
+
+Ell::Ell(const Csr &csr) : rows_(csr.rows), cols_(csr.cols), width_(0)
+{
+    for (std::size_t r = 0; r < rows_; ++r)
+    {
+        width_ = std::max<std::size_t>(width_, csr.rowPtr[r + 1] - csr.rowPtr[r]);
+    }
+    colIdx_.assign(rows_ * width_, 0);
+    values_.assign(rows_ * width_, 0.0);
+    for (std::size_t r = 0; r < rows_; ++r)
+    {
+        std::size_t j = 0;
+        for (uint32_t k = csr.rowPtr[r]; k < csr.rowPtr[r + 1]; ++k, ++j)
+        {
+            colIdx_[r * width_ + j] = csr.colIdx[k];
+            values_[r * width_ + j] = csr.values[k];
+        }
+        uint32_t pad = j > 0 ? colIdx_[r * width_ + j - 1] : 0;
+        for (; j < width_; ++j)
+        {
+            colIdx_[r * width_ + j] = pad;
+        }
+    }
+}
+
+void Ell::multiply(const double *x, double *y, std::size_t rowBegin, std::size_t rowEnd) const
+{
+    const uint32_t *col = colIdx_.data();
+    const double *val = values_.data();
+    for (std::size_t r = rowBegin; r < rowEnd; ++r)
+    {
+        double sum = 0.0;
+        for (std::size_t j = r * width_; j < (r + 1) * width_; ++j)
+        {
+            sum += val[j] * x[col[j]];
+        }
+        y[r] = sum;
+    }
+}
+
+double Ell::bytes() const
+{
+    return double(values_.size()) * (sizeof(double) + sizeof(uint32_t)) + double(cols_ + rows_) * sizeof(double);
+}
+
+Sell::Sell(const Csr &csr, std::size_t sigma) : rows_(csr.rows), cols_(csr.cols)
+{
+    auto length = [&csr](uint32_t r) { return csr.rowPtr[r + 1] - csr.rowPtr[r]; };
+
+    // Sort by descending length inside each sigma window only, so rows
+    // stay near their neighbours and x accesses keep some locality.
+    perm_.resize(rows_);
+    std::iota(perm_.begin(), perm_.end(), 0);
+    for (std::size_t w = 0; w < rows_; w += sigma)
+    {
+        auto end = perm_.begin() + std::min(rows_, w + sigma);
+        std::stable_sort(perm_.begin() + w, end, [&](uint32_t a, uint32_t b) { return length(a) > length(b); });
+    }
+
+    const std::size_t slices = (rows_ + kSliceHeight - 1) / kSliceHeight;
+    slicePtr_.push_back(0);
+    for (std::size_t s = 0; s < slices; ++s)
+    {
+        uint32_t len = 0;
+        for (std::size_t i = s * kSliceHeight; i < std::min(rows_, (s + 1) * kSliceHeight); ++i)
+        {
+            len = std::max(len, length(perm_[i]));
+        }
+        sliceLen_.push_back(len);
+        slicePtr_.push_back(slicePtr_.back() + uint32_t(len * kSliceHeight));
+    }
+
+    colIdx_.assign(slicePtr_.back(), 0);
+    values_.assign(slicePtr_.back(), 0.0);
+    for (std::size_t s = 0; s < slices; ++s)
+    {
+        for (std::size_t lane = 0; lane < kSliceHeight; ++lane)
+        {
+            std::size_t i = s * kSliceHeight + lane;
+            if (i >= rows_)
+            {
+                break;
+            }
+            uint32_t r = perm_[i];
+            for (uint32_t j = 0; j < length(r); ++j)
+            {
+                colIdx_[slicePtr_[s] + j * kSliceHeight + lane] = csr.colIdx[csr.rowPtr[r] + j];
+                values_[slicePtr_[s] + j * kSliceHeight + lane] = csr.values[csr.rowPtr[r] + j];
+            }
+        }
+    }
+}
+
+void Sell::multiply(const double *x, double *y, std::size_t sliceBegin, std::size_t sliceEnd) const
+{
+    const uint32_t *col = colIdx_.data();
+    const double *val = values_.data();
+    for (std::size_t s = sliceBegin; s < sliceEnd; ++s)
+    {
+        // One accumulator per row of the slice: independent chains.
+        double sum[kSliceHeight] = {};
+        const std::size_t base = slicePtr_[s];
+        for (std::size_t j = 0; j < sliceLen_[s]; ++j)
+        {
+            const std::size_t k = base + j * kSliceHeight;
+            for (std::size_t lane = 0; lane < kSliceHeight; ++lane)
+            {
+                sum[lane] += val[k + lane] * x[col[k + lane]];
+            }
+        }
+        const std::size_t rows = std::min(kSliceHeight, rows_ - s * kSliceHeight);
+        for (std::size_t lane = 0; lane < rows; ++lane)
+        {
+            y[perm_[s * kSliceHeight + lane]] = sum[lane];
+        }
+    }
+}
+
+double Sell::bytes() const
+{
+    return double(values_.size()) * (sizeof(double) + sizeof(uint32_t)) +
+           double(slicePtr_.size() + sliceLen_.size() + rows_) * sizeof(uint32_t) +
+           double(cols_ + rows_) * sizeof(double);
+}
+
+std::vector<std::pair<std::size_t, std::size_t>> balancedSplit(const std::vector<uint32_t> &prefix, int parts)
+{
+    const std::size_t n = prefix.size() - 1;
+    std::vector<std::pair<std::size_t, std::size_t>> ranges;
+    std::size_t begin = 0;
+    for (int p = 1; p <= parts; ++p)
+    {
+        std::size_t end = n;
+        if (p < parts)
+        {
+            const double target = double(prefix.back()) * p / parts;
+            end = std::size_t(std::lower_bound(prefix.begin(), prefix.end(), target) - prefix.begin());
+            end = std::min(std::max(end, begin), n);
+        }
+        ranges.emplace_back(begin, end);
+        begin = end;
+    }
+    return ranges;
+}
+
+std::vector<std::pair<std::size_t, std::size_t>> uniformSplit(std::size_t n, int parts)
+{
+    std::vector<std::pair<std::size_t, std::size_t>> ranges;
+    for (int p = 0; p < parts; ++p)
+    {
+        ranges.emplace_back(n * p / parts, n * (p + 1) / parts);
+    }
+    return ranges;
+}
+
+} // namespace sparse
@@ -0,0 +1,92 @@
+// Sparse.h
+// Sparse matrices in CSR, ELL and SELL-C-sigma form with SpMV kernels and
+// test-matrix generators, used by the sparse matrix-vector benchmark.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace sparse {
+
+// Compressed sparse rows, column indices sorted within each row.
+struct Csr {
+    std::size_t rows{0};
+    std::size_t cols{0};
+    std::vector<uint32_t> rowPtr; // rows + 1 offsets into colIdx/values
+    std::vector<uint32_t> colIdx;
+    std::vector<double> values;
+
+    std::size_t nnz() const { return values.size(); }
+
+    // y[r] = sum A[r][c] * x[c] for rows [rowBegin, rowEnd).
+    void multiply(const double *x, double *y, std::size_t rowBegin, std::size_t rowEnd) const;
+
+    // Minimum memory traffic of one full SpMV: the matrix once, x once,
+    // y once.
+    double bytes() const;
+};
+
+// Square test matrices with values in [-1, 1].
+Csr banded(std::size_t rows, std::size_t halfWidth, uint32_t seed);
+Csr randomUniform(std::size_t rows, std::size_t perRow, uint32_t seed);
+// Row lengths follow a Pareto distribution (mean about meanPerRow, capped
+// at maxPerRow); a few very long rows, many short ones.
+Csr powerLaw(std::size_t rows, std::size_t meanPerRow, std::size_t maxPerRow, uint32_t seed);
+
+// ELLPACK: every row padded to the longest one, stored row-major so rows
+// can be split between threads. Padding has value 0 and repeats the last
+// valid column.
+class Ell {
+public:
+    explicit Ell(const Csr &csr);
+
+    std::size_t width() const { return width_; }
+
+    void multiply(const double *x, double *y, std::size_t rowBegin, std::size_t rowEnd) const;
+    double bytes() const;
+
+private:
+    std::size_t rows_, cols_, width_;
+    std::vector<uint32_t> colIdx_;
+    std::vector<double> values_;
+};
+
+// SELL-C-sigma (Kreutzer et al.): rows sorted by length within windows of
+// sigma rows, cut into slices of kSliceHeight rows, each slice padded to
+// its own longest row and stored column-major. Short padding, and the
+// slice's rows can be processed in independent lanes.
+class Sell {
+public:
+    static constexpr std::size_t kSliceHeight = 8;
+
+    Sell(const Csr &csr, std::size_t sigma);
+
+    std::size_t slices() const { return sliceLen_.size(); }
+    // Entry offset of each slice, slices() + 1 values; also a prefix sum
+    // of stored entries for balancing.
+    const std::vector<uint32_t> &slicePtr() const { return slicePtr_; }
+    std::size_t storedEntries() const { return values_.size(); }
+
+    void multiply(const double *x, double *y, std::size_t sliceBegin, std::size_t sliceEnd) const;
+    double bytes() const;
+
+private:
+    std::size_t rows_, cols_;
+    std::vector<uint32_t> perm_; // Slice row -> matrix row
+    std::vector<uint32_t> slicePtr_;
+    std::vector<uint32_t> sliceLen_;
+    std::vector<uint32_t> colIdx_;
+    std::vector<double> values_;
+};
+
+// Splits [0, prefix.size() - 1) into parts ranges carrying roughly equal
+// shares of prefix.back() (e.g. nonzeros, given CSR row pointers).
+std::vector<std::pair<std::size_t, std::size_t>> balancedSplit(const std::vector<uint32_t> &prefix, int parts);
+
+// Splits [0, n) into parts ranges of (almost) equal length.
+std::vector<std::pair<std::size_t, std::size_t>> uniformSplit(std::size_t n, int parts);
+
+} // namespace sparse
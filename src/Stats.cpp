@@ -0,0 +1,306 @@
+// Stats.cpp
+// Welford moments, tree reductions, histograms and the P² quantile sketch.
+
+#include "Stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace stats {
+
+namespace {
+
+// 4 KB of floats: small enough that the second pass over a block hits L1.
+constexpr std::size_t kBlock = 1024;
+constexpr std::size_t kLanes = 8;
+
+// Moments of one cache-resident block. Values are shifted by the first
+// element so the float lane sums stay small and keep their precision.
+Moments blockMoments(const float *data, std::size_t n)
+{
+    const float shift = data[0];
+    float sum[kLanes] = {};
+    float lo[kLanes], hi[kLanes];
+    std::fill(lo, lo + kLanes, shift);
+    std::fill(hi, hi + kLanes, shift);
+
+    std::size_t i = 0;
+    for (; i + kLanes <= n; i += kLanes)
+    {
+        for (std::size_t l = 0; l < kLanes; ++l)
+        {
+            float x = data[i + l];
+            sum[l] += x - shift;
+            lo[l] = x < lo[l] ? x : lo[l];
+            hi[l] = x > hi[l] ? x : hi[l];
+        }
+    }
+    for (; i < n; ++i)
+    {
+        float x = data[i];
+        sum[0] += x - shift;
+        lo[0] = x < lo[0] ? x : lo[0];
+        hi[0] = x > hi[0] ? x : hi[0];
+    }
+
+    double total = 0.0;
+    Moments m;
+    m.count = n;
+    m.min = lo[0];
+    m.max = hi[0];
+    for (std::size_t l = 0; l < kLanes; ++l)
+    {
+        total += sum[l];
+        m.min = std::min(m.min, double(lo[l]));
+        m.max = std::max(m.max, double(hi[l]));
+    }
+    m.mean = shift + total / double(n);
+
+    // Second pass over the same block, now from L1.
+    const float mean = float(m.mean);
+    float sq[kLanes] = {};
+    for (i = 0; i + kLanes <= n; i += kLanes)
+    {
+        for (std::size_t l = 0; l < kLanes; ++l)
+        {
+            float d = data[i + l] - mean;
+            sq[l] += d * d;
+        }
+    }
+    for (; i < n; ++i)
+    {
+        float d = data[i] - mean;
+        sq[0] += d * d;
+    }
+    for (std::size_t l = 0; l < kLanes; ++l)
+    {
+        m.m2 += sq[l];
+    }
+    // Correct for the rounding of mean to float.
+    double offset = double(mean) - m.mean;
+    m.m2 -= double(n) * offset * offset;
+    return m;
+}
+
+} // namespace
+
+void Moments::add(double x)
+{
+    if (count == 0)
+    {
+        min = max = x;
+    }
+    else
+    {
+        min = std::min(min, x);
+        max = std::max(max, x);
+    }
+    ++count;
+    double delta = x - mean;
+    mean += delta / double(count);
+    m2 += delta * (x - mean);
+}
+
+void Moments::merge(const Moments &other)
+{
+    if (other.count == 0)
+    {
+        return;
+    }
+    if (count == 0)
+    {
+        *this = other;
+        return;
+    }
+    double n = double(count) + double(other.count);
+    double delta = other.mean - mean;
+    mean += delta * double(other.count) / n;
+    m2 += other.m2 + delta * delta * double(count) * double(other.count) / n;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    count += other.count;
+}
+
+Moments welford(const float *data, std::size_t n)
+{
+    Moments m;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        m.add(data[i]);
+    }
+    return m;
+}
+
+Moments blockedWelford(const float *data, std::size_t n)
+{
+    Moments m;
+    for (std::size_t i = 0; i < n; i += kBlock)
+    {
+        m.merge(blockMoments(data + i, std::min(kBlock, n - i)));
+    }
+    return m;
+}
+
+void reduceTree(std::vector<Moments> &partials, int rank, int ranks, Barrier &barrier)
+{
+    for (int stride = 1; stride < ranks; stride *= 2)
+    {
+        barrier.wait(); // Partners have finished the previous round
+        if (rank % (2 * stride) == 0 && rank + stride < ranks)
+        {
+            partials[rank].merge(partials[rank + stride]);
+        }
+    }
+    barrier.wait();
+}
+
+Histogram::Histogram(std::size_t bins, double lo, double hi)
+    : lo_(lo), hi_(hi), scale_(double(bins) / (hi - lo)), counts_(bins, 0), sub_(4 * bins, 0)
+{
+}
+
+void Histogram::add(const float *data, std::size_t n)
+{
+    const std::size_t bins = counts_.size();
+    const float lo = float(lo_);
+    const float scale = float(scale_);
+    const float limit = float(bins);
+
+    // Four interleaved sub-histograms, so runs of samples landing in the
+    // same bin do not serialise on one counter's load-increment-store.
+    uint64_t *sub = sub_.data();
+    uint64_t under = 0, over = 0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        float t = (data[i] - lo) * scale;
+        if (!(t >= 0.0f)) // Also catches NaN
+        {
+            ++under;
+        }
+        else if (t >= limit)
+        {
+            ++over;
+        }
+        else
+        {
+            ++sub[(i & 3) * bins + std::size_t(t)];
+        }
+    }
+
+    // Drain the sub-histograms, leaving them zeroed for the next call.
+    for (std::size_t b = 0; b < bins; ++b)
+    {
+        counts_[b] += sub[b] + sub[bins + b] + sub[2 * bins + b] + sub[3 * bins + b];
+        sub[b] = sub[bins + b] = sub[2 * bins + b] = sub[3 * bins + b] = 0;
+    }
+    underflow_ += under;
+    overflow_ += over;
+}
+
+uint64_t Histogram::total() const
+{
+    uint64_t sum = underflow_ + overflow_;
+    for (uint64_t c : counts_)
+    {
+        sum += c;
+    }
+    return sum;
+}
+
+P2Quantile::P2Quantile(double p)
+    : p_(p),
+      q_{},
+      n_{0, 1, 2, 3, 4},
+      desired_{0, 2 * p, 4 * p, 2 + 2 * p, 4},
+      increment_{0, p / 2, p, (1 + p) / 2, 1}
+{
+}
+
+void P2Quantile::add(double x)
+{
+    // The first five samples seed the markers.
+    if (count_ < 5)
+    {
+        q_[count_++] = x;
+        if (count_ == 5)
+        {
+            std::sort(q_, q_ + 5);
+        }
+        return;
+    }
+    ++count_;
+
+    int k;
+    if (x < q_[0])
+    {
+        q_[0] = x;
+        k = 0;
+    }
+    else if (x >= q_[4])
+    {
+        q_[4] = x;
+        k = 3;
+    }
+    else
+    {
+        k = 0;
+        while (x >= q_[k + 1])
+        {
+            ++k;
+        }
+    }
+
+    for (int i = k + 1; i < 5; ++i)
+    {
+        n_[i] += 1;
+    }
+    for (int i = 0; i < 5; ++i)
+    {
+        desired_[i] += increment_[i];
+    }
+
+    // Move the middle markers towards their desired positions, one step
+    // at a time, along a parabola through their neighbours.
+    for (int i = 1; i < 4; ++i)
+    {
+        double d = desired_[i] - n_[i];
+        if ((d >= 1 && n_[i + 1] - n_[i] > 1) || (d <= -1 && n_[i - 1] - n_[i] < -1))
+        {
+            int step = d > 0 ? 1 : -1;
+            double q = parabolic(i, step);
+            q_[i] = (q_[i - 1] < q && q < q_[i + 1]) ? q : linear(i, step);
+            n_[i] += step;
+        }
+    }
+}
+
+double P2Quantile::parabolic(int i, double d) const
+{
+    return q_[i] + d / (n_[i + 1] - n_[i - 1]) *
+                       ((n_[i] - n_[i - 1] + d) * (q_[i + 1] - q_[i]) / (n_[i + 1] - n_[i]) +
+                        (n_[i + 1] - n_[i] - d) * (q_[i] - q_[i - 1]) / (n_[i] - n_[i - 1]));
+}
+
+double P2Quantile::linear(int i, int d) const
+{
+    return q_[i] + d * (q_[i + d] - q_[i]) / (n_[i + d] - n_[i]);
+}
+
+double P2Quantile::value() const
+{
+    if (count_ >= 5)
+    {
+        return q_[2];
+    }
+    if (count_ == 0)
+    {
+        return 0.0;
+    }
+    // Too few samples for the markers: exact quantile of what we have.
+    double sorted[5];
+    std::copy(q_, q_ + count_, sorted);
+    std::sort(sorted, sorted + count_);
+    return sorted[std::size_t(p_ * double(count_ - 1) + 0.5)];
+}
+
+} // namespace stats
@@ -0,0 +1,85 @@
+// Stats.h
+// Streaming statistics (moments, histograms, quantile sketches), used by
+// the statistical computation benchmark.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Barrier.h"
+
+namespace stats {
+
+// Count, mean, sum of squared deviations, min and max. Partial results
+// from separate chunks or threads combine exactly with merge().
+struct Moments {
+    uint64_t count{0};
+    double mean{0.0};
+    double m2{0.0};
+    double min{0.0};
+    double max{0.0};
+
+    // Welford's update: one pass, no catastrophic cancellation.
+    void add(double x);
+    // Chan et al. pairwise combination of two partial results.
+    void merge(const Moments &other);
+
+    double variance() const { return count > 1 ? m2 / double(count - 1) : 0.0; }
+};
+
+// Textbook Welford, one add() per element. The division per element and
+// the loop-carried mean make it latency bound.
+Moments welford(const float *data, std::size_t n);
+
+// Same result, one pass over memory: each cache-resident block is reduced
+// with independent (vectorisable) sums, then merged into the running total.
+Moments blockedWelford(const float *data, std::size_t n);
+
+// Tree reduction of per-thread partials: every rank stores its own moments
+// in partials[rank], then calls this with the barrier shared by all ranks.
+// After log2(ranks) merge rounds partials[0] holds the total.
+void reduceTree(std::vector<Moments> &partials, int rank, int ranks, Barrier &barrier);
+
+// Fixed-width histogram over [lo, hi) with separate under/overflow counts.
+class Histogram {
+public:
+    Histogram(std::size_t bins, double lo, double hi);
+
+    void add(const float *data, std::size_t n);
+
+    const std::vector<uint64_t> &counts() const { return counts_; }
+    uint64_t underflow() const { return underflow_; }
+    uint64_t overflow() const { return overflow_; }
+    uint64_t total() const;
+
+private:
+    double lo_, hi_, scale_;
+    std::vector<uint64_t> counts_;
+    std::vector<uint64_t> sub_; // Scratch for add(), zero between calls
+    uint64_t underflow_{0}, overflow_{0};
+};
+
+// Jain & Chlamtac's P² estimator: tracks one quantile of a stream in five
+// markers, O(1) memory and no stored samples.
+class P2Quantile {
+public:
+    explicit P2Quantile(double p);
+
+    void add(double x);
+    double value() const;
+
+private:
+    double parabolic(int i, double d) const;
+    double linear(int i, int d) const;
+
+    double p_;
+    uint64_t count_{0};
+    double q_[5];      // Marker heights
+    double n_[5];      // Marker positions
+    double desired_[5];
+    double increment_[5];
+};
+
+} // namespace stats
@@ -0,0 +1,313 @@
+// Storage.cpp
+// Scratch file handling and the timed read/write loops of the storage
+// I/O benchmark.
+
+#include "Storage.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+namespace storage {
+
+namespace {
+
+constexpr std::size_t kPageBytes = 4096;
+constexpr std::size_t kFillBytes = 1024 * 1024;
+constexpr std::size_t kMinBytes = 8 * 1024 * 1024;
+
+std::system_error systemError(const std::string &what)
+{
+    return std::system_error(errno, std::generic_category(), what);
+}
+
+// Value stored at byte offset `offset` of the file.
+uint64_t expected(std::size_t offset)
+{
+    return uint64_t(offset / sizeof(uint64_t)) * 0x9E3779B97F4A7C15ull;
+}
+
+// Writes the check values into the pages of a buffer destined for file
+// offset `offset`.
+void stampPages(char *buffer, std::size_t bytes, std::size_t offset)
+{
+    for (std::size_t page = 0; page < bytes; page += kPageBytes)
+    {
+        const std::size_t last = page + kPageBytes - sizeof(uint64_t);
+        const uint64_t head = expected(offset + page);
+        const uint64_t tail = expected(offset + last);
+        std::memcpy(buffer + page, &head, sizeof(head));
+        std::memcpy(buffer + last, &tail, sizeof(tail));
+    }
+}
+
+bool pagesIntact(const char *buffer, std::size_t bytes, std::size_t offset)
+{
+    for (std::size_t page = 0; page < bytes; page += kPageBytes)
+    {
+        const std::size_t last = page + kPageBytes - sizeof(uint64_t);
+        uint64_t head, tail;
+        std::memcpy(&head, buffer + page, sizeof(head));
+        std::memcpy(&tail, buffer + last, sizeof(tail));
+        if (head != expected(offset + page) || tail != expected(offset + last))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct FreeDeleter {
+    void operator()(char *p) const { std::free(p); }
+};
+typedef std::unique_ptr<char, FreeDeleter> Buffer;
+
+// Page-aligned, as O_DIRECT requires, and filled with noise so that no
+// layer below can shortcut zero pages.
+Buffer allocateBuffer(std::size_t bytes, uint32_t seed)
+{
+    void *p = nullptr;
+    if (posix_memalign(&p, kPageBytes, bytes) != 0)
+    {
+        throw std::bad_alloc();
+    }
+    Buffer buffer(static_cast<char *>(p));
+    std::mt19937 engine(seed);
+    for (std::size_t i = 0; i < bytes; i += sizeof(uint32_t))
+    {
+        const uint32_t word = engine();
+        std::memcpy(buffer.get() + i, &word, sizeof(word));
+    }
+    return buffer;
+}
+
+void transfer(int fd, bool write, char *buffer, std::size_t bytes, std::size_t offset)
+{
+    const ssize_t done = write ? pwrite(fd, buffer, bytes, off_t(offset)) : pread(fd, buffer, bytes, off_t(offset));
+    if (done != ssize_t(bytes))
+    {
+        if (done >= 0)
+        {
+            errno = EIO; // Short transfer
+        }
+        throw systemError(write ? "pwrite" : "pread");
+    }
+}
+
+double seconds(std::chrono::steady_clock::duration d)
+{
+    return std::chrono::duration<double>(d).count();
+}
+
+} // namespace
+
+const char *methodName(Method method)
+{
+    switch (method)
+    {
+    case Method::Buffered:
+        return "buf";
+    case Method::Mmap:
+        return "mmap";
+    case Method::Direct:
+        return "direct";
+    }
+    return "?";
+}
+
+ScratchFile::ScratchFile(const std::string &dir, std::size_t maxBytes)
+{
+    struct statvfs fs;
+    if (statvfs(dir.c_str(), &fs) != 0)
+    {
+        throw systemError(dir);
+    }
+    const uint64_t available = uint64_t(fs.f_bavail) * fs.f_frsize;
+    size_ = std::size_t(std::min<uint64_t>(maxBytes, available / 2)) / kFillBytes * kFillBytes;
+    if (size_ < kMinBytes)
+    {
+        throw std::runtime_error("not enough free space in " + dir);
+    }
+
+    std::string name = dir + "/mathbench-io-XXXXXX";
+    fd_ = mkstemp(&name[0]);
+    if (fd_ < 0)
+    {
+        throw systemError(dir);
+    }
+    path_ = name;
+
+    try
+    {
+        Buffer chunk = allocateBuffer(kFillBytes, 1);
+        for (std::size_t offset = 0; offset < size_; offset += kFillBytes)
+        {
+            stampPages(chunk.get(), kFillBytes, offset);
+            transfer(fd_, true, chunk.get(), kFillBytes, offset);
+        }
+        if (fdatasync(fd_) != 0)
+        {
+            throw systemError("fdatasync");
+        }
+        map();
+    }
+    catch (...)
+    {
+        close(fd_);
+        unlink(path_.c_str());
+        throw;
+    }
+
+    // Not every filesystem takes O_DIRECT (tmpfs before Linux 6.6 fails
+    // the open with EINVAL); the direct rows are skipped there.
+    directFd_ = open(path_.c_str(), O_RDWR | O_DIRECT);
+}
+
+ScratchFile::~ScratchFile()
+{
+    unmap();
+    if (directFd_ >= 0)
+    {
+        close(directFd_);
+    }
+    close(fd_);
+    unlink(path_.c_str());
+}
+
+void ScratchFile::map()
+{
+    void *p = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED)
+    {
+        throw systemError("mmap");
+    }
+    mapping_ = static_cast<char *>(p);
+}
+
+void ScratchFile::unmap()
+{
+    if (mapping_)
+    {
+        munmap(mapping_, size_);
+        mapping_ = nullptr;
+    }
+}
+
+void ScratchFile::sync(Method method)
+{
+    if (method == Method::Mmap)
+    {
+        if (msync(mapping_, size_, MS_SYNC) != 0)
+        {
+            throw systemError("msync");
+        }
+    }
+    else if (fdatasync(method == Method::Direct ? directFd_ : fd_) != 0)
+    {
+        throw systemError("fdatasync");
+    }
+}
+
+void ScratchFile::dropCache()
+{
+    // Pages still mapped are not evicted, so the mapping goes first.
+    sync(Method::Mmap);
+    unmap();
+    sync(Method::Buffered);
+    posix_fadvise(fd_, 0, 0, POSIX_FADV_DONTNEED);
+    map();
+}
+
+void run(ScratchFile &file, const Request &request, std::size_t first, std::size_t ops, uint32_t seed,
+         std::vector<double> &latencies)
+{
+    const std::size_t block = request.block;
+    Buffer buffer = allocateBuffer(block, seed);
+    std::mt19937 engine(seed);
+    std::uniform_int_distribution<std::size_t> pick(0, file.size() / block - 1);
+
+    char *mapping = file.mapping();
+    const int fd = request.method == Method::Direct ? file.directFd() : file.fd();
+    if (request.method == Method::Mmap)
+    {
+        madvise(mapping, file.size(), request.random ? MADV_RANDOM : MADV_SEQUENTIAL);
+    }
+
+    latencies.reserve(latencies.size() + ops);
+    for (std::size_t i = 0; i < ops; ++i)
+    {
+        const std::size_t offset = (request.random ? pick(engine) : first + i) * block;
+        if (request.write)
+        {
+            stampPages(buffer.get(), block, offset);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        if (request.method == Method::Mmap)
+        {
+            if (request.write)
+            {
+                std::memcpy(mapping + offset, buffer.get(), block);
+            }
+            else
+            {
+                std::memcpy(buffer.get(), mapping + offset, block);
+            }
+        }
+        else
+        {
+            transfer(fd, request.write, buffer.get(), block, offset);
+        }
+        latencies.push_back(seconds(std::chrono::steady_clock::now() - start));
+
+        if (!request.write && !pagesIntact(buffer.get(), block, offset))
+        {
+            throw std::runtime_error("wrong data read back at offset " + std::to_string(offset));
+        }
+    }
+}
+
+void runSynced(ScratchFile &file, bool dataOnly, std::size_t first, std::size_t ops, std::vector<double> &latencies)
+{
+    Buffer buffer = allocateBuffer(kPageBytes, uint32_t(first));
+    latencies.reserve(latencies.size() + ops);
+    for (std::size_t i = 0; i < ops; ++i)
+    {
+        const std::size_t offset = (first + i) * kPageBytes % file.size();
+        stampPages(buffer.get(), kPageBytes, offset);
+
+        const auto start = std::chrono::steady_clock::now();
+        transfer(file.fd(), true, buffer.get(), kPageBytes, offset);
+        if ((dataOnly ? fdatasync(file.fd()) : fsync(file.fd())) != 0)
+        {
+            throw systemError(dataOnly ? "fdatasync" : "fsync");
+        }
+        latencies.push_back(seconds(std::chrono::steady_clock::now() - start));
+    }
+}
+
+double percentile(std::vector<double> samples, double fraction)
+{
+    if (samples.empty())
+    {
+        return 0.0;
+    }
+    const std::size_t rank = std::size_t(std::ceil(fraction * samples.size()));
+    const std::size_t index = std::min(samples.size(), std::max<std::size_t>(rank, 1)) - 1;
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+} // namespace storage
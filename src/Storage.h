@@ -0,0 +1,82 @@
+// Storage.h
+// Scratch file and read/write/mmap/O_DIRECT access loops, used by the
+// storage I/O benchmark.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace storage {
+
+enum class Method {
+    Buffered, // pread/pwrite through the page cache
+    Mmap,     // memcpy to/from a shared mapping of the file
+    Direct    // pread/pwrite on an O_DIRECT descriptor
+};
+
+// Short label for row titles: "buf", "mmap", "direct".
+const char *methodName(Method method);
+
+// A file of pseudo-random data in a given directory, deleted again by the
+// destructor. The first and last 8 bytes of every 4 KB page hold a value
+// derived from their offset, so reads can be checked; writes keep that
+// invariant.
+class ScratchFile {
+public:
+    // Up to maxBytes, but at most half the free space in dir (whole MB).
+    // Throws if dir is not writable or has less than 16 MB free.
+    ScratchFile(const std::string &dir, std::size_t maxBytes);
+    ~ScratchFile();
+    ScratchFile(const ScratchFile &) = delete;
+    ScratchFile &operator=(const ScratchFile &) = delete;
+
+    const std::string &path() const { return path_; }
+    std::size_t size() const { return size_; }
+
+    int fd() const { return fd_; }
+    // -1 where the filesystem refuses O_DIRECT (e.g. older tmpfs).
+    int directFd() const { return directFd_; }
+    char *mapping() const { return mapping_; }
+
+    // Makes writes done with method durable (fdatasync or msync).
+    void sync(Method method);
+    // Writes everything back, evicts the file from the page cache and
+    // maps it afresh, so the next buffered or mmap reads hit the device.
+    void dropCache();
+
+private:
+    std::string path_;
+    std::size_t size_{0};
+    int fd_{-1};
+    int directFd_{-1};
+    char *mapping_{nullptr};
+
+    void map();
+    void unmap();
+};
+
+struct Request {
+    Method method;
+    bool write;
+    bool random;       // Block-aligned uniform offsets, else consecutive blocks
+    std::size_t block; // Bytes per operation, a multiple of 4 KB
+};
+
+// Runs ops operations on file. Sequential requests cover blocks
+// [first, first + ops); random ones draw offsets from seed. Appends each
+// operation's latency in seconds to latencies. Throws std::system_error on
+// I/O errors and std::runtime_error if data read back does not match.
+void run(ScratchFile &file, const Request &request, std::size_t first, std::size_t ops, uint32_t seed,
+         std::vector<double> &latencies);
+
+// 4 KB writes to consecutive pages starting at page first, each followed
+// by fsync (or fdatasync); the latency covers both.
+void runSynced(ScratchFile &file, bool dataOnly, std::size_t first, std::size_t ops, std::vector<double> &latencies);
+
+// Value below which the given fraction of samples lies (nearest rank).
+double percentile(std::vector<double> samples, double fraction);
+
+} // namespace storage
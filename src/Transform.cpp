@@ -0,0 +1,480 @@
+// Transform.cpp
+// Scalar and SIMD vertex transformation kernels for each buffer layout.
+
+#include "Transform.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+#include "CpuFeatures.h"
+#include "Simd.h"
+
+namespace xform {
+
+namespace {
+
+using simd::Vec4;
+
+static_assert(VertexBuffer::kBlock % simd::kMaxWidth == 0, "AoSoA blocks must hold whole vectors");
+
+// Position: clip = mvp * (x, y, z, 1), then divide by w. Normal: 3x3.
+inline void transformVertex(const float *m, const float *nm, const float in[6], float out[6])
+{
+    const float x = in[0], y = in[1], z = in[2];
+    const float cx = m[0] * x + m[4] * y + m[8] * z + m[12];
+    const float cy = m[1] * x + m[5] * y + m[9] * z + m[13];
+    const float cz = m[2] * x + m[6] * y + m[10] * z + m[14];
+    const float cw = m[3] * x + m[7] * y + m[11] * z + m[15];
+    const float inv = 1.0f / cw;
+    out[0] = cx * inv;
+    out[1] = cy * inv;
+    out[2] = cz * inv;
+
+    const float nx = in[3], ny = in[4], nz = in[5];
+    out[3] = nm[0] * nx + nm[3] * ny + nm[6] * nz;
+    out[4] = nm[1] * nx + nm[4] * ny + nm[7] * nz;
+    out[5] = nm[2] * nx + nm[5] * ny + nm[8] * nz;
+}
+
+// One vector of vertices from six component streams; matrix entries
+// broadcast.
+template <typename V>
+SIMD_INLINE void transformStreams(const float *m, const float *nm, const float *const in[6], float *const out[6],
+                                  std::size_t begin, std::size_t end)
+{
+    for (std::size_t i = begin; i < end; i += simd::lanes<V>())
+    {
+        const V x = simd::load<V>(in[0] + i), y = simd::load<V>(in[1] + i), z = simd::load<V>(in[2] + i);
+        const V cx = m[0] * x + m[4] * y + m[8] * z + m[12];
+        const V cy = m[1] * x + m[5] * y + m[9] * z + m[13];
+        const V cz = m[2] * x + m[6] * y + m[10] * z + m[14];
+        const V cw = m[3] * x + m[7] * y + m[11] * z + m[15];
+        const V inv = 1.0f / cw;
+        simd::store(out[0] + i, cx * inv);
+        simd::store(out[1] + i, cy * inv);
+        simd::store(out[2] + i, cz * inv);
+
+        const V nx = simd::load<V>(in[3] + i), ny = simd::load<V>(in[4] + i), nz = simd::load<V>(in[5] + i);
+        simd::store(out[3] + i, nm[0] * nx + nm[3] * ny + nm[6] * nz);
+        simd::store(out[4] + i, nm[1] * nx + nm[4] * ny + nm[7] * nz);
+        simd::store(out[5] + i, nm[2] * nx + nm[5] * ny + nm[8] * nz);
+    }
+}
+
+// AoSoA blocks are six kBlock-long streams back to back.
+template <typename V>
+SIMD_INLINE void transformBlocks(const float *m, const float *nm, const float *in, float *out, std::size_t blocks)
+{
+    constexpr std::size_t kBlock = VertexBuffer::kBlock;
+    for (std::size_t b = 0; b < blocks; ++b)
+    {
+        const float *blockIn[6];
+        float *blockOut[6];
+        for (int k = 0; k < 6; ++k)
+        {
+            blockIn[k] = in + (b * 6 + k) * kBlock;
+            blockOut[k] = out + (b * 6 + k) * kBlock;
+        }
+        transformStreams<V>(m, nm, blockIn, blockOut, 0, kBlock);
+    }
+}
+
+void transformStreamsBaseline(const float *m, const float *nm, const float *const in[6], float *const out[6],
+                              std::size_t begin, std::size_t end)
+{
+    transformStreams<simd::Vec4>(m, nm, in, out, begin, end);
+}
+
+void transformBlocksBaseline(const float *m, const float *nm, const float *in, float *out, std::size_t blocks)
+{
+    transformBlocks<simd::Vec4>(m, nm, in, out, blocks);
+}
+
+#if defined(SIMD_AVX2_VARIANT)
+SIMD_AVX2_TARGET
+void transformStreamsAvx2(const float *m, const float *nm, const float *const in[6], float *const out[6],
+                          std::size_t begin, std::size_t end)
+{
+    transformStreams<simd::Vec8>(m, nm, in, out, begin, end);
+}
+
+SIMD_AVX2_TARGET
+void transformBlocksAvx2(const float *m, const float *nm, const float *in, float *out, std::size_t blocks)
+{
+    transformBlocks<simd::Vec8>(m, nm, in, out, blocks);
+}
+#elif defined(SIMD_NEON_VARIANT)
+SIMD_NEON_TARGET
+void transformStreamsNeon(const float *m, const float *nm, const float *const in[6], float *const out[6],
+                          std::size_t begin, std::size_t end)
+{
+    transformStreams<simd::Vec4>(m, nm, in, out, begin, end);
+}
+
+SIMD_NEON_TARGET
+void transformBlocksNeon(const float *m, const float *nm, const float *in, float *out, std::size_t blocks)
+{
+    transformBlocks<simd::Vec4>(m, nm, in, out, blocks);
+}
+#endif
+
+Matrix4 identity()
+{
+    Matrix4 r{};
+    r.m[0] = r.m[5] = r.m[10] = r.m[15] = 1.0f;
+    return r;
+}
+
+} // namespace
+
+const char *layoutName(Layout layout)
+{
+    switch (layout)
+    {
+    case Layout::AoS:
+        return "AoS";
+    case Layout::SoA:
+        return "SoA";
+    case Layout::AoSoA:
+        return "AoSoA";
+    }
+    return "unknown";
+}
+
+const char *simdName(Layout layout)
+{
+    // AoS keeps one vertex per 4-wide vector, so wider variants do not help it.
+    return cpu::simdLevelName(layout == Layout::AoS ? cpu::SimdLevel::Baseline : cpu::simdLevel());
+}
+
+Matrix4 multiply(const Matrix4 &a, const Matrix4 &b)
+{
+    Matrix4 r{};
+    for (int c = 0; c < 4; ++c)
+    {
+        for (int row = 0; row < 4; ++row)
+        {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; ++k)
+            {
+                sum += a.m[k * 4 + row] * b.m[c * 4 + k];
+            }
+            r.m[c * 4 + row] = sum;
+        }
+    }
+    return r;
+}
+
+Matrix4 perspective(float fovY, float aspect, float zNear, float zFar)
+{
+    const float f = 1.0f / std::tan(fovY / 2.0f);
+    Matrix4 r{};
+    r.m[0] = f / aspect;
+    r.m[5] = f;
+    r.m[10] = (zFar + zNear) / (zNear - zFar);
+    r.m[11] = -1.0f;
+    r.m[14] = 2.0f * zFar * zNear / (zNear - zFar);
+    return r;
+}
+
+Matrix4 translation(float x, float y, float z)
+{
+    Matrix4 r = identity();
+    r.m[12] = x;
+    r.m[13] = y;
+    r.m[14] = z;
+    return r;
+}
+
+Matrix4 rotation(float angle, float x, float y, float z)
+{
+    const float c = std::cos(angle), s = std::sin(angle), t = 1.0f - c;
+    Matrix4 r = identity();
+    r.m[0] = t * x * x + c;
+    r.m[1] = t * x * y + s * z;
+    r.m[2] = t * x * z - s * y;
+    r.m[4] = t * x * y - s * z;
+    r.m[5] = t * y * y + c;
+    r.m[6] = t * y * z + s * x;
+    r.m[8] = t * x * z + s * y;
+    r.m[9] = t * y * z - s * x;
+    r.m[10] = t * z * z + c;
+    return r;
+}
+
+void normalMatrix(const Matrix4 &model, float out[9])
+{
+    for (int c = 0; c < 3; ++c)
+    {
+        for (int row = 0; row < 3; ++row)
+        {
+            out[c * 3 + row] = model.m[c * 4 + row];
+        }
+    }
+}
+
+VertexBuffer::VertexBuffer(Layout layout, std::size_t n, uint32_t seed)
+    : layout_(layout), n_(n), padded_((n + kBlock - 1) / kBlock * kBlock)
+{
+    switch (layout_)
+    {
+    case Layout::AoS:
+        aosIn_.assign(padded_, Vertex{});
+        aosOut_.assign(padded_, Vertex{});
+        break;
+    case Layout::SoA:
+        for (int k = 0; k < 6; ++k)
+        {
+            soaIn_[k].assign(padded_, 0.0f);
+            soaOut_[k].assign(padded_, 0.0f);
+        }
+        break;
+    case Layout::AoSoA:
+        blockIn_.assign(padded_ / kBlock, Block{});
+        blockOut_.assign(padded_ / kBlock, Block{});
+        break;
+    }
+
+    std::mt19937 engine(seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::normal_distribution<float> gauss(0.0f, 1.0f);
+    for (std::size_t i = 0; i < n_; ++i)
+    {
+        float v[6];
+        for (int k = 0; k < 3; ++k)
+        {
+            v[k] = unit(engine);
+        }
+        float length;
+        do
+        {
+            for (int k = 3; k < 6; ++k)
+            {
+                v[k] = gauss(engine);
+            }
+            length = std::sqrt(v[3] * v[3] + v[4] * v[4] + v[5] * v[5]);
+        } while (length < 1e-3f);
+        for (int k = 3; k < 6; ++k)
+        {
+            v[k] /= length;
+        }
+
+        switch (layout_)
+        {
+        case Layout::AoS:
+            std::copy(v, v + 3, aosIn_[i].position);
+            std::copy(v + 3, v + 6, aosIn_[i].normal);
+            break;
+        case Layout::SoA:
+            for (int k = 0; k < 6; ++k)
+            {
+                soaIn_[k][i] = v[k];
+            }
+            break;
+        case Layout::AoSoA:
+            for (int k = 0; k < 6; ++k)
+            {
+                blockIn_[i / kBlock].v[k][i % kBlock] = v[k];
+            }
+            break;
+        }
+    }
+}
+
+void VertexBuffer::input(std::size_t i, float v[6]) const
+{
+    switch (layout_)
+    {
+    case Layout::AoS:
+        std::copy(aosIn_[i].position, aosIn_[i].position + 3, v);
+        std::copy(aosIn_[i].normal, aosIn_[i].normal + 3, v + 3);
+        break;
+    case Layout::SoA:
+        for (int k = 0; k < 6; ++k)
+        {
+            v[k] = soaIn_[k][i];
+        }
+        break;
+    case Layout::AoSoA:
+        for (int k = 0; k < 6; ++k)
+        {
+            v[k] = blockIn_[i / kBlock].v[k][i % kBlock];
+        }
+        break;
+    }
+}
+
+void VertexBuffer::output(std::size_t i, float v[6]) const
+{
+    switch (layout_)
+    {
+    case Layout::AoS:
+        std::copy(aosOut_[i].position, aosOut_[i].position + 3, v);
+        std::copy(aosOut_[i].normal, aosOut_[i].normal + 3, v + 3);
+        break;
+    case Layout::SoA:
+        for (int k = 0; k < 6; ++k)
+        {
+            v[k] = soaOut_[k][i];
+        }
+        break;
+    case Layout::AoSoA:
+        for (int k = 0; k < 6; ++k)
+        {
+            v[k] = blockOut_[i / kBlock].v[k][i % kBlock];
+        }
+        break;
+    }
+}
+
+void VertexBuffer::transform(const Matrix4 &mvp, const float normal[9], bool vectorised, std::size_t begin,
+                             std::size_t end)
+{
+    begin = begin / kBlock * kBlock;
+    end = std::min(padded_, (end + kBlock - 1) / kBlock * kBlock);
+
+    switch (layout_)
+    {
+    case Layout::AoS:
+        vectorised ? transformAoSVector(mvp, normal, begin, end) : transformAoS(mvp, normal, begin, end);
+        break;
+    case Layout::SoA:
+        vectorised ? transformSoAVector(mvp, normal, begin, end) : transformSoA(mvp, normal, begin, end);
+        break;
+    case Layout::AoSoA:
+        vectorised ? transformAoSoAVector(mvp, normal, begin, end) : transformAoSoA(mvp, normal, begin, end);
+        break;
+    }
+}
+
+void VertexBuffer::transformAoS(const Matrix4 &mvp, const float normal[9], std::size_t begin, std::size_t end)
+{
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        const Vertex &v = aosIn_[i];
+        const float in[6] = {v.position[0], v.position[1], v.position[2], v.normal[0], v.normal[1], v.normal[2]};
+        float out[6];
+        transformVertex(mvp.m, normal, in, out);
+        std::copy(out, out + 3, aosOut_[i].position);
+        std::copy(out + 3, out + 6, aosOut_[i].normal);
+    }
+}
+
+// One vertex per vector: the matrix columns stay in registers and each
+// vertex is a weighted sum of them. Lane 3 of every store is wasted and
+// the divide needs w broadcast from the last lane.
+void VertexBuffer::transformAoSVector(const Matrix4 &mvp, const float normal[9], std::size_t begin, std::size_t end)
+{
+    const Vec4 c0 = simd::load<Vec4>(mvp.m), c1 = simd::load<Vec4>(mvp.m + 4);
+    const Vec4 c2 = simd::load<Vec4>(mvp.m + 8), c3 = simd::load<Vec4>(mvp.m + 12);
+    const Vec4 n0 = {normal[0], normal[1], normal[2], 0.0f};
+    const Vec4 n1 = {normal[3], normal[4], normal[5], 0.0f};
+    const Vec4 n2 = {normal[6], normal[7], normal[8], 0.0f};
+
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        const Vertex &v = aosIn_[i];
+        const Vec4 clip = c0 * v.position[0] + c1 * v.position[1] + c2 * v.position[2] + c3;
+        const Vec4 p = clip * (1.0f / clip[3]);
+        const Vec4 n = n0 * v.normal[0] + n1 * v.normal[1] + n2 * v.normal[2];
+        std::memcpy(aosOut_[i].position, &p, sizeof(aosOut_[i].position));
+        std::memcpy(aosOut_[i].normal, &n, sizeof(aosOut_[i].normal));
+    }
+}
+
+void VertexBuffer::transformSoA(const Matrix4 &mvp, const float normal[9], std::size_t begin, std::size_t end)
+{
+    const float *in[6];
+    float *out[6];
+    for (int k = 0; k < 6; ++k)
+    {
+        in[k] = soaIn_[k].data();
+        out[k] = soaOut_[k].data();
+    }
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        const float v[6] = {in[0][i], in[1][i], in[2][i], in[3][i], in[4][i], in[5][i]};
+        float r[6];
+        transformVertex(mvp.m, normal, v, r);
+        for (int k = 0; k < 6; ++k)
+        {
+            out[k][i] = r[k];
+        }
+    }
+}
+
+void VertexBuffer::transformSoAVector(const Matrix4 &mvp, const float normal[9], std::size_t begin, std::size_t end)
+{
+    const float *in[6];
+    float *out[6];
+    for (int k = 0; k < 6; ++k)
+    {
+        in[k] = soaIn_[k].data();
+        out[k] = soaOut_[k].data();
+    }
+    switch (cpu::simdLevel())
+    {
+#if defined(SIMD_AVX2_VARIANT)
+    case cpu::SimdLevel::Avx2:
+        transformStreamsAvx2(mvp.m, normal, in, out, begin, end);
+        break;
+#elif defined(SIMD_NEON_VARIANT)
+    case cpu::SimdLevel::Neon:
+        transformStreamsNeon(mvp.m, normal, in, out, begin, end);
+        break;
+#endif
+    default:
+        transformStreamsBaseline(mvp.m, normal, in, out, begin, end);
+        break;
+    }
+}
+
+void VertexBuffer::transformAoSoA(const Matrix4 &mvp, const float normal[9], std::size_t begin, std::size_t end)
+{
+    for (std::size_t b = begin / kBlock; b < end / kBlock; ++b)
+    {
+        const Block &block = blockIn_[b];
+        for (std::size_t l = 0; l < kBlock; ++l)
+        {
+            float in[6], out[6];
+            for (int k = 0; k < 6; ++k)
+            {
+                in[k] = block.v[k][l];
+            }
+            transformVertex(mvp.m, normal, in, out);
+            for (int k = 0; k < 6; ++k)
+            {
+                blockOut_[b].v[k][l] = out[k];
+            }
+        }
+    }
+}
+
+// Same arithmetic as SoA, but each block's six streams share a few cache
+// lines, so a batch touches one contiguous region instead of twelve.
+void VertexBuffer::transformAoSoAVector(const Matrix4 &mvp, const float normal[9], std::size_t begin,
+                                        std::size_t end)
+{
+    const float *in = blockIn_[begin / kBlock].v[0];
+    float *out = blockOut_[begin / kBlock].v[0];
+    const std::size_t blocks = (end - begin) / kBlock;
+    switch (cpu::simdLevel())
+    {
+#if defined(SIMD_AVX2_VARIANT)
+    case cpu::SimdLevel::Avx2:
+        transformBlocksAvx2(mvp.m, normal, in, out, blocks);
+        break;
+#elif defined(SIMD_NEON_VARIANT)
+    case cpu::SimdLevel::Neon:
+        transformBlocksNeon(mvp.m, normal, in, out, blocks);
+        break;
+#endif
+    default:
+        transformBlocksBaseline(mvp.m, normal, in, out, blocks);
+        break;
+    }
+}
+
+} // namespace xform
@@ -0,0 +1,85 @@
+// Transform.h
+// Batched vertex transformation (model-view-projection plus normals) over
+// AoS, SoA and AoSoA vertex buffers, used by the 3D transformation
+// benchmark.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace xform {
+
+enum class Layout {
+    AoS,  // One {position, normal} record per vertex
+    SoA,  // One array per component
+    AoSoA // Blocks of kBlock vertices, one short array per component
+};
+
+const char *layoutName(Layout layout);
+
+// Column-major 4x4 matrix, as uploaded to a GPU.
+struct Matrix4 {
+    float m[16];
+};
+
+// SIMD level the vectorised kernel for a layout runs at, e.g. "AVX2".
+const char *simdName(Layout layout);
+
+Matrix4 multiply(const Matrix4 &a, const Matrix4 &b);
+Matrix4 perspective(float fovY, float aspect, float zNear, float zFar);
+Matrix4 translation(float x, float y, float z);
+Matrix4 rotation(float angle, float x, float y, float z); // Unit axis
+
+// Upper-left 3x3 of a rigid model matrix, column-major. For rotations and
+// translations this is also the normal matrix.
+void normalMatrix(const Matrix4 &model, float out[9]);
+
+class VertexBuffer {
+public:
+    // Vertices per AoSoA block; buffers are padded to a whole block.
+    static constexpr std::size_t kBlock = 8;
+
+    // n random vertices in [-1, 1]^3 with random unit normals.
+    VertexBuffer(Layout layout, std::size_t n, uint32_t seed);
+
+    Layout layout() const { return layout_; }
+    std::size_t size() const { return n_; }
+
+    // Transforms vertices [begin, end) into the output buffer: positions
+    // by mvp followed by the perspective divide, normals by the normal
+    // matrix. The range is widened to whole blocks.
+    void transform(const Matrix4 &mvp, const float normal[9], bool vectorised, std::size_t begin, std::size_t end);
+
+    // Component access in {px, py, pz, nx, ny, nz} order, for checking.
+    void input(std::size_t i, float v[6]) const;
+    void output(std::size_t i, float v[6]) const;
+
+private:
+    struct Vertex {
+        float position[3];
+        float normal[3];
+    };
+    struct Block {
+        float v[6][kBlock];
+    };
+
+    void transformAoS(const Matrix4 &mvp, const float normal[9], std::size_t begin, std::size_t end);
+    void transformAoSVector(const Matrix4 &mvp, const float normal[9], std::size_t begin, std::size_t end);
+    void transformSoA(const Matrix4 &mvp, const float normal[9], std::size_t begin, std::size_t end);
+    void transformSoAVector(const Matrix4 &mvp, const float normal[9], std::size_t begin, std::size_t end);
+    void transformAoSoA(const Matrix4 &mvp, const float normal[9], std::size_t begin, std::size_t end);
+    void transformAoSoAVector(const Matrix4 &mvp, const float normal[9], std::size_t begin, std::size_t end);
+
+    Layout layout_;
+    std::size_t n_;
+    std::size_t padded_;
+
+    // Only the vectors for layout_ are populated.
+    std::vector<Vertex> aosIn_, aosOut_;
+    std::vector<float> soaIn_[6], soaOut_[6];
+    std::vector<Block> blockIn_, blockOut_;
+};
+
+} // namespace xform
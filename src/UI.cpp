@@ -7,6 +7,7 @@
 #include <sstream>
 #include <cmath>
 #include <algorithm>
+#include <iterator>
 
 // ANSI escape codes for terminal control
 #define CLEAR_SCREEN "\033[2J"
@@ -15,13 +16,14 @@
 #define SHOW_CURSOR "\033[?25h"
 #define BOLD "\033[1m"
 #define RESET "\033[0m"
+#define RED "\033[31m"
 #define GREEN "\033[32m"
 #define YELLOW "\033[33m"
 #define CYAN "\033[36m"
 #define DIM "\033[2m"
 
 UI::UI(int threadCount) 
-    : threadCount_(threadCount), startTime_(std::chrono::steady_clock::now()) {
+    : threadCount_(threadCount), scrolled_(false), startTime_(std::chrono::steady_clock::now()) {
 }
 
 void UI::init() {
@@ -30,11 +32,41 @@ void UI::init() {
     startTime_ = std::chrono::steady_clock::now();
 }
 
+void UI::setCpuInfo(const std::string& simdLevel, const std::string& features) {
+    simdLevel_ = simdLevel;
+    cpuFeatures_ = features;
+}
+
 void UI::cleanup() {
     showCursor();
     std::cout << std::endl;
 }
 
+void UI::printResults() {
+    bool anyFailed = std::any_of(benchmarks_.begin(), benchmarks_.end(),
+                                 [](const BenchmarkResult& b) { return b.failed; });
+    if (!scrolled_ && !anyFailed) {
+        return;
+    }
+    
+    if (!simdLevel_.empty()) {
+        std::cout << "\n " << BOLD << "SIMD: " << RESET << simdLevel_
+                  << "  " << BOLD << "CPU features: " << RESET << cpuFeatures_ << "\n";
+    }
+    std::cout << "\n" << BOLD << " " << padRight("Benchmark", 32) << padRight("Avg time", 15)
+              << "Ops/sec" << RESET << "\n";
+    for (const auto& bench : benchmarks_) {
+        std::cout << " " << padRight(bench.name, 32);
+        if (bench.failed) {
+            std::cout << RED << "FAILED: " << bench.error << RESET << "\n";
+        } else {
+            std::cout << padRight(formatDuration(bench.avgDuration), 15)
+                      << formatOpsPerSec(bench.opsPerSec, bench.unit, bench.rate) << "\n";
+        }
+    }
+    std::cout << std::flush;
+}
+
 void UI::clearScreen() {
     std::cout << CLEAR_SCREEN << std::flush;
 }
@@ -122,28 +154,45 @@ void UI::drawBenchmarkList() {
     moveCursor(row++, 1);
     std::cout << DIM << "────────────────────────────────────────────────────────────────────────────────" << RESET;
     
-    // Benchmark rows
-    for (size_t i = 0; i < benchmarks_.size() && row < maxRows + 4; ++i) {
+    // Benchmark rows. When there are more than fit, keep the newest (and
+    // therefore the running one) on screen and let older rows scroll off.
+    size_t visibleRows = static_cast<size_t>(maxRows + 4 - row);
+    size_t first = 0;
+    if (benchmarks_.size() > visibleRows) {
+        first = benchmarks_.size() - visibleRows;
+        scrolled_ = true;
+    }
+    
+    for (size_t i = first; i < benchmarks_.size() && row < maxRows + 4; ++i) {
         const auto& bench = benchmarks_[i];
         moveCursor(row++, 1);
         
         std::string shortName = truncate(bench.name, 28);
         std::cout << " " << padRight(shortName, 30);
         
-        if (bench.completed) {
+        if (bench.completed && bench.failed) {
+            std::cout << RED << padRight("✗ Failed", 12) << RESET;
+            if (threadCount_ == 1) {
+                std::cout << padRight("---", 15);
+                std::cout << padRight("---", 18);
+            } else {
+                std::cout << padRight("---", 20);
+                std::cout << padRight("---", 13);
+            }
+        } else if (bench.completed) {
             std::cout << GREEN << padRight("✓ Done", 12) << RESET;
             
             if (threadCount_ == 1) {
                 // Single thread: show just the time
                 std::cout << padRight(formatDuration(bench.avgDuration), 15);
-                std::cout << padRight(formatOpsPerSec(bench.opsPerSec), 18);
+                std::cout << padRight(formatOpsPerSec(bench.opsPerSec, bench.unit, bench.rate), 18);
             } else {
                 // Multi-thread: show min/max
                 double minDuration = *std::min_element(bench.threadDurations.begin(), bench.threadDurations.end());
                 double maxDuration = *std::max_element(bench.threadDurations.begin(), bench.threadDurations.end());
                 std::string minMaxStr = formatDuration(minDuration) + "/" + formatDuration(maxDuration);
                 std::cout << padRight(minMaxStr, 20);
-                std::cout << padRight(formatOpsPerSec(bench.opsPerSec), 13);
+                std::cout << padRight(formatOpsPerSec(bench.opsPerSec, bench.unit, bench.rate), 13);
             }
         } else if (bench.name == currentBenchmark_) {
             std::cout << YELLOW << padRight("⟳ Running...", 12) << RESET;
@@ -188,6 +237,9 @@ void UI::drawFooter() {
     status << " Threads: " << threadCount_ 
            << " │ Completed: " << completedCount << "/" << benchmarks_.size()
            << " │ Elapsed: " << elapsed << "s";
+    if (!simdLevel_.empty()) {
+        status << " │ SIMD: " << simdLevel_;
+    }
     
     std::cout << padRight(status.str(), 78);
     std::cout << CYAN << "║" << RESET;
@@ -219,15 +271,17 @@ void UI::showSummary() {
     std::cout << BOLD << " Top Performers:" << RESET << "\n";
     std::cout << DIM << " ───────────────────────────────────────────────────────────────────────────────" << RESET << "\n";
     
-    // Sort by ops/sec
-    std::vector<BenchmarkResult> sorted = benchmarks_;
+    // Sort by ops/sec; rows holding a plain amount are not rates
+    std::vector<BenchmarkResult> sorted;
+    std::copy_if(benchmarks_.begin(), benchmarks_.end(), std::back_inserter(sorted),
+                 [](const BenchmarkResult& b) { return b.rate; });
     std::sort(sorted.begin(), sorted.end(), [](const BenchmarkResult& a, const BenchmarkResult& b) {
         return a.opsPerSec > b.opsPerSec;
     });
     
     for (size_t i = 0; i < std::min(size_t(5), sorted.size()); ++i) {
         std::cout << "  " << (i + 1) << ". " << padRight(sorted[i].name, 40) 
-                  << GREEN << formatOpsPerSec(sorted[i].opsPerSec) << RESET << "\n";
+                  << GREEN << formatOpsPerSec(sorted[i].opsPerSec, sorted[i].unit) << RESET << "\n";
     }
     
     std::cout << "\n";
@@ -235,7 +289,9 @@ void UI::showSummary() {
 }
 
 std::string UI::formatDuration(double seconds) {
-    if (seconds < 0.001) {
+    if (seconds < 0.000001) {
+        return std::to_string(static_cast<int>(seconds * 1000000000)) + " ns";
+    } else if (seconds < 0.001) {
         return std::to_string(static_cast<int>(seconds * 1000000)) + " μs";
     } else if (seconds < 1.0) {
         return std::to_string(static_cast<int>(seconds * 1000)) + " ms";
@@ -246,24 +302,23 @@ std::string UI::formatDuration(double seconds) {
     }
 }
 
-std::string UI::formatOpsPerSec(double ops) {
+std::string UI::formatOpsPerSec(double ops, const std::string& unit, bool perSecond) {
+    if (!perSecond && unit == "s") {
+        return formatDuration(ops);
+    }
+    const char* suffix = perSecond ? "/s" : "";
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(2);
     if (ops >= 1e9) {
-        std::ostringstream ss;
-        ss << std::fixed << std::setprecision(2) << (ops / 1e9) << " Gops/s";
-        return ss.str();
+        ss << (ops / 1e9) << " G" << unit << suffix;
     } else if (ops >= 1e6) {
-        std::ostringstream ss;
-        ss << std::fixed << std::setprecision(2) << (ops / 1e6) << " Mops/s";
-        return ss.str();
+        ss << (ops / 1e6) << " M" << unit << suffix;
     } else if (ops >= 1e3) {
-        std::ostringstream ss;
-        ss << std::fixed << std::setprecision(2) << (ops / 1e3) << " Kops/s";
-        return ss.str();
+        ss << (ops / 1e3) << " K" << unit << suffix;
     } else {
-        std::ostringstream ss;
-        ss << std::fixed << std::setprecision(2) << ops << " ops/s";
-        return ss.str();
+        ss << ops << " " << unit << suffix;
     }
+    return ss.str();
 }
 
 std::string UI::truncate(const std::string& str, size_t width) {
@@ -273,18 +328,45 @@ std::string UI::truncate(const std::string& str, size_t width) {
     return str.substr(0, width - 3) + "...";
 }
 
+namespace {
+
+// Terminal columns taken by a UTF-8 string. Every symbol the UI prints
+// (box drawing, ✓, ⟳, μ) is one column wide, so count code points.
+size_t displayWidth(const std::string& str) {
+    size_t width = 0;
+    for (unsigned char c : str) {
+        if ((c & 0xC0) != 0x80) width++;
+    }
+    return width;
+}
+
+// The first `width` columns of str, without splitting a code point.
+std::string truncateWidth(const std::string& str, size_t width) {
+    size_t columns = 0;
+    for (size_t i = 0; i < str.size(); i++) {
+        if ((static_cast<unsigned char>(str[i]) & 0xC0) != 0x80 && columns++ == width) {
+            return str.substr(0, i);
+        }
+    }
+    return str;
+}
+
+} // namespace
+
 std::string UI::padRight(const std::string& str, size_t width) {
-    if (str.length() >= width) {
-        return str.substr(0, width);
+    size_t length = displayWidth(str);
+    if (length >= width) {
+        return truncateWidth(str, width);
     }
-    return str + std::string(width - str.length(), ' ');
+    return str + std::string(width - length, ' ');
 }
 
 std::string UI::padLeft(const std::string& str, size_t width) {
-    if (str.length() >= width) {
-        return str.substr(0, width);
+    size_t length = displayWidth(str);
+    if (length >= width) {
+        return truncateWidth(str, width);
     }
-    return std::string(width - str.length(), ' ') + str;
+    return std::string(width - length, ' ') + str;
 }
 
 void UI::drawProgressBar(int row, double percentage) {
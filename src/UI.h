@@ -13,12 +13,16 @@ struct BenchmarkResult {
     std::vector<double> threadDurations;
     double totalDuration;
     double avgDuration;
-    double opsPerSec;
+    double opsPerSec;       // Work units per second, see unit
+    std::string unit;       // "ops", "B" (bytes), ...
+    bool rate;              // False: opsPerSec is a plain amount of unit, e.g. peak RSS
     size_t iterations;
     bool completed;
+    bool failed;            // A worker threw, e.g. a self-check mismatch
+    std::string error;
     
     BenchmarkResult() : totalDuration(0.0), avgDuration(0.0), opsPerSec(0.0), 
-                       iterations(0), completed(false) {}
+                       unit("ops"), rate(true), iterations(0), completed(false), failed(false) {}
 };
 
 class UI {
@@ -28,6 +32,10 @@ public:
     // Initialize the UI and clear the screen
     void init();
     
+    // SIMD level the vector kernels dispatched to and the detected CPU
+    // features, shown in the footer and the results table
+    void setCpuInfo(const std::string& simdLevel, const std::string& features);
+    
     // Start a new benchmark (show it as "Running...")
     void startBenchmark(const std::string& name, size_t iterations);
     
@@ -42,9 +50,16 @@ public:
     
     // Clean up and restore terminal
     void cleanup();
+    
+    // Print every result as plain text. Only does anything when rows
+    // scrolled off the screen or a benchmark failed (to show why).
+    void printResults();
 
 private:
     int threadCount_;
+    bool scrolled_;
+    std::string simdLevel_;
+    std::string cpuFeatures_;
     std::vector<BenchmarkResult> benchmarks_;
     std::string currentBenchmark_;
     std::chrono::time_point<std::chrono::steady_clock> startTime_;
@@ -63,7 +78,7 @@ private:
     
     // Helper functions
     std::string formatDuration(double seconds);
-    std::string formatOpsPerSec(double ops);
+    std::string formatOpsPerSec(double ops, const std::string& unit = "ops", bool perSecond = true);
     std::string truncate(const std::string& str, size_t width);
     std::string padRight(const std::string& str, size_t width);
     std::string padLeft(const std::string& str, size_t width);